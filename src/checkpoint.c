@@ -0,0 +1,208 @@
+/**
+ * @file checkpoint.c
+ * @brief Checkpoint of pending directories, to resume listing
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. save_checkpoint(path, inflight, ninflight, &pos); (periodically)
+ * 2. load_checkpoint(path, &pos); (when resuming, adds to the queue)
+ *
+ * A checkpoint is a header (the position) followed by the names of the
+ * pending directories: first the ones taken from the queue but not yet
+ * printed, then the queue of list.c, in the order to be listed.
+ * It is written to a temporary file, synced and renamed, so that the
+ * checkpoint file is always a complete one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pdir.h"
+#include "list.h"
+#include "checkpoint.h"
+
+/**
+ * Checkpoint identifier, and format version
+ */
+#define CHECKPOINT_MAGIC	"PDIRCKPT"
+#define CHECKPOINT_VERSION	1
+
+/**
+ * struct checkpoint_header - Header of checkpoint file.
+ * @magic:   CHECKPOINT_MAGIC
+ * @version: CHECKPOINT_VERSION
+ * @printed: a directory has been printed
+ * @done:    count of directories printed
+ *
+ * Each pending directory follows as its length (uint32_t, including
+ * '\0') and name.
+ */
+struct checkpoint_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t printed;
+	uint64_t done;
+};
+
+/**
+ * write_name - Append a directory name to checkpoint
+ * @fp:   checkpoint file
+ * @name: directory name (terminated by '\0')
+ * @len:  length of `name` including '\0'
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int write_name(FILE *fp, const char *name, size_t len)
+{
+	uint32_t n = len;
+
+	if (len > UINT32_MAX || fwrite(&n, sizeof(n), 1, fp) != 1 ||
+					fwrite(name, 1, len, fp) != len)
+		return CHECKPOINT_FAILURE;
+	return 0;
+}
+
+/**
+ * write_queued - `fn` of walk_list(), append a queued directory
+ * @data: directory name
+ * @len:  length of `data`
+ * @arg:  checkpoint file
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int write_queued(const void *data, size_t len, void *arg)
+{
+	return write_name(arg, data, len);
+}
+
+/**
+ * save_checkpoint - Write pending directories, and position
+ * @path:      checkpoint file name
+ * @inflight:  directories taken from queue, not yet printed (in order)
+ * @ninflight: count of `inflight`
+ * @pos:       position of listing
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int save_checkpoint(const char *path, char *const *inflight, size_t ninflight,
+				const struct checkpoint_pos *pos)
+{
+	struct checkpoint_header header;
+	char *tmp;
+	FILE *fp = NULL;
+	size_t i;
+	int fd;
+	int ret = CHECKPOINT_FAILURE;
+
+	tmp = malloc(strlen(path) + sizeof("-XXXXXX"));
+	if (!tmp)
+		return ALLOCATION_FAILURE;
+	sprintf(tmp, "%s-XXXXXX", path);
+
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto out;
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		goto err;
+	}
+
+	memset(&header, '\0', sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.printed = pos->printed;
+	header.done = pos->done;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+		goto err;
+
+	for (i = 0; i < ninflight; i++)
+		if (write_name(fp, inflight[i], strlen(inflight[i]) + 1))
+			goto err;
+	if (walk_list(write_queued, fp))
+		goto err;
+
+	if (fflush(fp) || fsync(fileno(fp)))
+		goto err;
+	ret = fclose(fp) ? CHECKPOINT_FAILURE : 0;
+	fp = NULL;
+	if (!ret && rename(tmp, path))
+		ret = CHECKPOINT_FAILURE;
+	if (!ret)
+		goto out;
+
+err:
+	if (fp)
+		fclose(fp);
+	unlink(tmp);
+out:
+	free(tmp);
+	return ret;
+}
+
+/**
+ * load_checkpoint - Add pending directories of checkpoint to queue
+ * @path: checkpoint file name
+ * @pos:  Output. position of listing
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int load_checkpoint(const char *path, struct checkpoint_pos *pos)
+{
+	struct checkpoint_header header;
+	char *name = NULL;
+	uint32_t len;
+	FILE *fp;
+	int ret = CHECKPOINT_FAILURE;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return CHECKPOINT_FAILURE;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) ||
+		header.version != CHECKPOINT_VERSION) {
+		errno = EINVAL;
+		goto out;
+	}
+	pos->printed = header.printed;
+	pos->done = header.done;
+
+	while (fread(&len, sizeof(len), 1, fp) == 1) {
+		if (!len) {
+			errno = EINVAL;
+			goto out;
+		}
+		name = malloc(len);
+		if (!name) {
+			ret = ALLOCATION_FAILURE;
+			goto out;
+		}
+		if (fread(name, 1, len, fp) != len ||
+						name[len - 1] != '\0') {
+			errno = EINVAL;
+			goto out;
+		}
+		if (add_list(name, len)) {
+			ret = ALLOCATION_FAILURE;
+			goto out;
+		}
+		free(name);
+		name = NULL;
+	}
+	if (!ferror(fp))
+		ret = 0;
+out:
+	free(name);
+	fclose(fp);
+	return ret;
+}
@@ -0,0 +1,22 @@
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * struct checkpoint_pos - Position of listing.
+ * @printed: a directory has been printed (next one is preceded by a newline)
+ * @done:    count of directories printed
+ */
+struct checkpoint_pos {
+	bool printed;
+	uint64_t done;
+};
+
+/* checkpoint.c */
+extern int save_checkpoint(const char *, char *const *, size_t,
+				const struct checkpoint_pos *);
+extern int load_checkpoint(const char *, struct checkpoint_pos *);
+
+#endif
@@ -0,0 +1,451 @@
+/**
+ * @file color.c
+ * @brief Colorize file names (LS_COLORS)
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_colors(getenv("LS_COLORS"));
+ * 2. seq = color_lookup(name, ftypelet(mode), mode);
+ *    write seq->str, name, color_end()->str
+ * 3. clean_colors();
+ *
+ * LS_COLORS is parsed once. Escape sequences are assembled in advance
+ * ("\033[" VALUE "m"), extensions ("*.EXT") are put in a hash table,
+ * and file types are put in a table indexed by the letter of ftypelet().
+ * Therefore choosing a color does not depend on the size of LS_COLORS.
+ * Other suffixes are searched linearly, and as in GNU ls, the suffix
+ * entry given last in LS_COLORS wins over an earlier one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "color.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1
+};
+
+/**
+ * INDICATOR
+ * Same order as `indicator_name`.
+ */
+enum
+{
+	IND_LEFT, IND_RIGHT, IND_END, IND_RESET, IND_NORM, IND_FILE,
+	IND_DIR, IND_LINK, IND_FIFO, IND_SOCK, IND_BLK, IND_CHR,
+	IND_MISSING, IND_ORPHAN, IND_EXEC, IND_DOOR, IND_SETUID,
+	IND_SETGID, IND_STICKY, IND_OTHER_WRITABLE,
+	IND_STICKY_OTHER_WRITABLE, IND_CAP, IND_MULTIHARDLINK,
+	IND_CLR_TO_EOL,
+	IND_COUNT
+};
+
+/* two-letter keys of LS_COLORS */
+static const char indicator_name[IND_COUNT][3] =
+{
+	"lc", "rc", "ec", "rs", "no", "fi", "di", "ln", "pi", "so", "bd",
+	"cd", "mi", "or", "ex", "do", "su", "sg", "st", "ow", "tw", "ca",
+	"mh", "cl"
+};
+
+/* values used if LS_COLORS does not specify them (same as GNU ls) */
+static const char *const indicator_default[IND_COUNT] =
+{
+	"\033[", "m", NULL, "0", NULL, NULL, "01;34", "01;36", "33",
+	"01;35", "01;33", "01;33", NULL, NULL, "01;32", "01;35", "37;41",
+	"30;43", "37;44", "34;42", "30;42", NULL, NULL, "\033[K"
+};
+
+/**
+ * struct suffix_color - color of file name suffix ("*SUFFIX=VALUE").
+ * @suffix: suffix ("*.EXT" is stored as ".EXT")
+ * @len:    length of `suffix`
+ * @hash:   hash of `suffix`
+ * @order:  position among the suffix entries of LS_COLORS
+ * @seq:    escape sequence
+ */
+struct suffix_color {
+	char *suffix;
+	size_t len;
+	unsigned int hash;
+	size_t order;
+	struct color_seq seq;
+};
+
+/* value of each indicator */
+static char *indicator_value[IND_COUNT];
+/* assembled sequence of each indicator (str is NULL if no color) */
+static struct color_seq indicator_seq[IND_COUNT];
+/* sequence of each file type, indexed by ftypelet() */
+static const struct color_seq *type_seq[UCHAR_MAX + 1];
+/* "*.EXT" entries, open addressing hash table */
+static struct suffix_color *ext_table;
+static size_t ext_size;
+/* other suffixes ("*~", "*.tar.gz", ...), searched linearly */
+static struct suffix_color *suffix_list;
+static size_t suffix_count;
+
+/**
+ * hash_suffix - FNV-1a hash of suffix
+ * @s:   suffix
+ * @len: length of `s`
+ *
+ * Return: hash value
+ */
+static unsigned int hash_suffix(const char *s, size_t len)
+{
+	unsigned int h = 2166136261u;
+
+	while (len--) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/**
+ * make_seq - assemble escape sequence `lc VALUE rc`
+ * @seq:   output. escape sequence
+ * @value: VALUE of LS_COLORS (NULL or "" means no color)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int make_seq(struct color_seq *seq, const char *value)
+{
+	const char *lc = indicator_value[IND_LEFT];
+	const char *rc = indicator_value[IND_RIGHT];
+
+	seq->str = NULL;
+	seq->len = 0;
+	if (!value || !*value)
+		return 0;
+
+	seq->len = strlen(lc) + strlen(value) + strlen(rc);
+	seq->str = malloc(seq->len + 1);
+	if (!seq->str)
+		return ALLOCATION_FAILURE;
+	sprintf(seq->str, "%s%s%s", lc, value, rc);
+	return 0;
+}
+
+/**
+ * add_suffix - Add "*SUFFIX=VALUE" entry to `suffix_list`
+ * @key:   SUFFIX
+ * @value: VALUE
+ *
+ * Sequences are assembled later, when "lc" and "rc" are known.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int add_suffix(const char *key, const char *value)
+{
+	struct suffix_color *list, *new;
+
+	list = realloc(suffix_list, (suffix_count + 1) * sizeof(*list));
+	if (!list)
+		return ALLOCATION_FAILURE;
+	suffix_list = list;
+
+	new = &list[suffix_count];
+	new->suffix = strdup(key);
+	new->seq.str = strdup(value);
+	if (!new->suffix || !new->seq.str) {
+		free(new->suffix);
+		free(new->seq.str);
+		return ALLOCATION_FAILURE;
+	}
+	new->len = strlen(key);
+	new->hash = hash_suffix(key, new->len);
+	new->order = suffix_count;
+	suffix_count++;
+	return 0;
+}
+
+/**
+ * parse_colors - Store each entry of LS_COLORS
+ * @spec: LS_COLORS ("di=01;34:*.c=33:...")
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int parse_colors(const char *spec)
+{
+	char *buf, *item, *save = NULL, *value;
+	int i, ret = 0;
+
+	buf = strdup(spec);
+	if (!buf)
+		return ALLOCATION_FAILURE;
+
+	for (item = strtok_r(buf, ":", &save); item && !ret;
+				item = strtok_r(NULL, ":", &save)) {
+		value = strchr(item, '=');
+		if (!value)
+			continue;
+		*value++ = '\0';
+
+		if (item[0] == '*') {
+			ret = add_suffix(item + 1, value);
+			continue;
+		}
+		for (i = 0; i < IND_COUNT; i++)
+			if (!strcmp(item, indicator_name[i]))
+				break;
+		if (i == IND_COUNT)
+			continue;
+
+		free(indicator_value[i]);
+		indicator_value[i] = strdup(value);
+		if (!indicator_value[i])
+			ret = ALLOCATION_FAILURE;
+	}
+
+	free(buf);
+	return ret;
+}
+
+/**
+ * is_extension - Check whether suffix is simple extension (".EXT")
+ * @s: suffix
+ *
+ * Return: true  - suffix has only one '.' at the beginning
+ *         false - otherwise
+ */
+static bool is_extension(const char *s)
+{
+	return s[0] == '.' && !strchr(s + 1, '.');
+}
+
+/**
+ * build_tables - Assemble sequences, and build lookup tables
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int build_tables(void)
+{
+	size_t i, j, n = 0;
+	char *value;
+
+	for (i = 0; i < IND_COUNT; i++)
+		if (make_seq(&indicator_seq[i], indicator_value[i]))
+			return ALLOCATION_FAILURE;
+
+	for (i = 0; i < suffix_count; i++) {
+		value = suffix_list[i].seq.str;
+		if (make_seq(&suffix_list[i].seq, value)) {
+			suffix_list[i].seq.str = value;
+			return ALLOCATION_FAILURE;
+		}
+		free(value);
+		n += is_extension(suffix_list[i].suffix);
+	}
+
+	for (ext_size = 16; ext_size < 2 * n; ext_size *= 2)
+		;
+	ext_table = calloc(ext_size, sizeof(*ext_table));
+	if (!ext_table)
+		return ALLOCATION_FAILURE;
+
+	/* Later entries take priority, as in GNU ls */
+	for (i = 0, n = 0; i < suffix_count; i++) {
+		struct suffix_color *e = &suffix_list[i];
+
+		if (!is_extension(e->suffix)) {
+			suffix_list[n++] = *e;
+			continue;
+		}
+		for (j = e->hash & (ext_size - 1); ext_table[j].suffix;
+						j = (j + 1) & (ext_size - 1))
+			if (ext_table[j].len == e->len &&
+				!memcmp(ext_table[j].suffix, e->suffix, e->len))
+				break;
+		free(ext_table[j].suffix);
+		free(ext_table[j].seq.str);
+		ext_table[j] = *e;
+	}
+	suffix_count = n;
+
+	type_seq['-'] = &indicator_seq[IND_FILE];
+	type_seq['d'] = &indicator_seq[IND_DIR];
+	type_seq['l'] = &indicator_seq[IND_LINK];
+	type_seq['p'] = &indicator_seq[IND_FIFO];
+	type_seq['s'] = &indicator_seq[IND_SOCK];
+	type_seq['b'] = &indicator_seq[IND_BLK];
+	type_seq['c'] = &indicator_seq[IND_CHR];
+	return 0;
+}
+
+/**
+ * init_colors - Initialize color tables from LS_COLORS
+ * @spec: value of LS_COLORS (NULL means default colors)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int init_colors(const char *spec)
+{
+	int i;
+	const char *end;
+
+	for (i = 0; i < IND_COUNT; i++) {
+		if (!indicator_default[i])
+			continue;
+		indicator_value[i] = strdup(indicator_default[i]);
+		if (!indicator_value[i])
+			return ALLOCATION_FAILURE;
+	}
+
+	if (spec && parse_colors(spec))
+		return ALLOCATION_FAILURE;
+	if (build_tables())
+		return ALLOCATION_FAILURE;
+
+	/* "ec", or "lc rs rc" if not specified */
+	free(indicator_seq[IND_END].str);
+	if (indicator_value[IND_END]) {
+		end = indicator_value[IND_END];
+		indicator_seq[IND_END].len = strlen(end);
+		indicator_seq[IND_END].str = strdup(end);
+	} else {
+		make_seq(&indicator_seq[IND_END], indicator_value[IND_RESET]);
+	}
+	if (!indicator_seq[IND_END].str)
+		return ALLOCATION_FAILURE;
+	return 0;
+}
+
+/**
+ * lookup_suffix - Search color of file name suffix
+ * @name: File name
+ *
+ * The last matching entry of `suffix_list` and the matching extension
+ * are compared, and the one given later in LS_COLORS is chosen.
+ *
+ * Return: escape sequence, NULL if no suffix matches
+ */
+static const struct color_seq *lookup_suffix(const char *name)
+{
+	size_t i, len, elen;
+	const char *ext;
+	struct suffix_color *e, *found = NULL;
+
+	len = strlen(name);
+	for (i = suffix_count; i-- > 0; ) {
+		e = &suffix_list[i];
+		if (e->len <= len &&
+			!memcmp(e->suffix, name + len - e->len, e->len)) {
+			found = e;
+			break;
+		}
+	}
+
+	ext = strrchr(name, '.');
+	if (!ext)
+		goto out;
+	elen = len - (ext - name);
+	for (i = hash_suffix(ext, elen) & (ext_size - 1); ext_table[i].suffix;
+					i = (i + 1) & (ext_size - 1)) {
+		e = &ext_table[i];
+		if (e->len == elen && !memcmp(e->suffix, ext, elen)) {
+			if (!found || found->order < e->order)
+				found = e;
+			break;
+		}
+	}
+out:
+	return found ? &found->seq : NULL;
+}
+
+/**
+ * color_lookup - Choose color of file
+ * @name:    File name
+ * @typelet: File type letter (ftypelet())
+ * @mode:    File mode
+ *
+ * Return: escape sequence to write before name, NULL if no color
+ */
+const struct color_seq *color_lookup(const char *name, char typelet,
+							mode_t mode)
+{
+	const struct color_seq *seq = NULL;
+
+	switch (typelet) {
+	case '-':
+		if ((mode & S_ISUID) && indicator_seq[IND_SETUID].str)
+			seq = &indicator_seq[IND_SETUID];
+		else if ((mode & S_ISGID) && indicator_seq[IND_SETGID].str)
+			seq = &indicator_seq[IND_SETGID];
+		else if ((mode & (S_IXUSR | S_IXGRP | S_IXOTH)) &&
+					indicator_seq[IND_EXEC].str)
+			seq = &indicator_seq[IND_EXEC];
+		else
+			seq = lookup_suffix(name);
+		break;
+	case 'd':
+		if ((mode & S_ISVTX) && (mode & S_IWOTH) &&
+			indicator_seq[IND_STICKY_OTHER_WRITABLE].str)
+			seq = &indicator_seq[IND_STICKY_OTHER_WRITABLE];
+		else if ((mode & S_IWOTH) &&
+				indicator_seq[IND_OTHER_WRITABLE].str)
+			seq = &indicator_seq[IND_OTHER_WRITABLE];
+		else if ((mode & S_ISVTX) && indicator_seq[IND_STICKY].str)
+			seq = &indicator_seq[IND_STICKY];
+		break;
+	}
+
+	if (!seq)
+		seq = type_seq[(unsigned char)typelet];
+	return (seq && seq->str) ? seq : NULL;
+}
+
+/**
+ * color_end - get escape sequence to write after colored name
+ *
+ * Return: escape sequence
+ */
+const struct color_seq *color_end(void)
+{
+	return &indicator_seq[IND_END];
+}
+
+/**
+ * clean_colors - clean up color tables
+ */
+void clean_colors(void)
+{
+	size_t i;
+
+	for (i = 0; i < IND_COUNT; i++) {
+		free(indicator_value[i]);
+		free(indicator_seq[i].str);
+		indicator_value[i] = NULL;
+		indicator_seq[i].str = NULL;
+	}
+	for (i = 0; i < suffix_count; i++) {
+		free(suffix_list[i].suffix);
+		free(suffix_list[i].seq.str);
+	}
+	for (i = 0; i < ext_size; i++) {
+		free(ext_table[i].suffix);
+		free(ext_table[i].seq.str);
+	}
+	free(suffix_list);
+	free(ext_table);
+	suffix_list = NULL;
+	ext_table = NULL;
+	suffix_count = 0;
+	ext_size = 0;
+}
@@ -0,0 +1,22 @@
+#ifndef _COLOR_H
+#define _COLOR_H
+
+#include <stdbool.h>
+
+/**
+ * struct color_seq - escape sequence, ready to be written.
+ * @str: sequence (not terminated by '\0')
+ * @len: length of `str`
+ */
+struct color_seq {
+	char *str;
+	size_t len;
+};
+
+/* color.c */
+extern int init_colors(const char *);
+extern const struct color_seq *color_lookup(const char *, char, mode_t);
+extern const struct color_seq *color_end(void);
+extern void clean_colors(void);
+
+#endif
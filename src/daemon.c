@@ -0,0 +1,418 @@
+/**
+ * @file daemon.c
+ * @brief Requests of listing passed over a Unix domain socket
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE (daemon)
+ * 1. fd = daemon_listen(path);
+ * 2. daemon_accept(fd, &req); (req.cwd, req.argc, req.argv, req.out, req.err)
+ *    (the environment of listing is set to that of the client)
+ * 3. daemon_reply(&req, status); (back to 2.)
+ *
+ * HOW TO USE (client)
+ * 1. status = daemon_call(path, argc, argv);
+ *
+ * A request is a header, with the standard output and error of the client
+ * passed as SCM_RIGHTS, followed by the working directory, environment
+ * and arguments of the client (each terminated by '\0', and environment
+ * by an empty string). Only the variables which change the listing
+ * (locale, LS_COLORS, TZ, ...) are passed. The daemon writes the listing
+ * directly to the passed descriptors, and replies the exit status.
+ * Only the user running the daemon is served.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	/* struct ucred */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "daemon.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ *  2: request is broken, or from another user
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1,
+	REQUEST_FAILURE = 2
+};
+
+/**
+ * Request identifier
+ */
+#define DAEMON_MAGIC	0x50444952	/* "PDIR" */
+
+/**
+ * struct daemon_header - Header of request.
+ * @magic:  DAEMON_MAGIC
+ * @length: bytes of working directory, environment and arguments following
+ */
+struct daemon_header {
+	uint32_t magic;
+	uint32_t length;
+};
+
+/* environment variables passed from client */
+static const char *const env_names[] = {
+	"LANG",
+	"LANGUAGE",
+	"LC_ALL",
+	"LC_CTYPE",
+	"LC_MESSAGES",
+	"LC_TIME",
+	"LS_COLORS",
+	"TMPDIR",
+	"TZ",
+	NULL
+};
+
+/**
+ * env_name - Search passed variable of environment string
+ * @env: environment string ("NAME=value")
+ *
+ * Return: index of `env_names`, -1 if not passed
+ */
+static int env_name(const char *env)
+{
+	int i;
+
+	for (i = 0; env_names[i]; i++) {
+		size_t len = strlen(env_names[i]);
+
+		if (!strncmp(env, env_names[i], len) && env[len] == '=')
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * set_environment - Set passed variables to those of client
+ * @env: environment of client ("NAME=value" strings, up to an empty one)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int set_environment(const char *env)
+{
+	int i;
+
+	for (i = 0; env_names[i]; i++)
+		unsetenv(env_names[i]);
+	for (; *env; env += strlen(env) + 1) {
+		i = env_name(env);
+		if (setenv(env_names[i], env + strlen(env_names[i]) + 1, 1))
+			return ALLOCATION_FAILURE;
+	}
+	return 0;
+}
+
+/**
+ * set_address - Set socket address of path
+ * @addr: Output. socket address
+ * @path: socket file name
+ *
+ * Return: 0 - success
+ *         -1 - `path` is too long (errno is ENAMETOOLONG)
+ */
+static int set_address(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, '\0', sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+/**
+ * full_io - Read or write all of buffer
+ * @fd:    file descriptor
+ * @buf:   buffer
+ * @len:   length of `buf`
+ * @write: write `buf` (otherwise, read into `buf`)
+ *
+ * Return: 0 - success
+ *         -1 - error, or end of file
+ */
+static int full_io(int fd, void *buf, size_t len, int write)
+{
+	char *p = buf;
+
+	while (len) {
+		ssize_t n = write ? send(fd, p, len, MSG_NOSIGNAL) :
+						recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/**
+ * daemon_listen - Create socket listening for requests
+ * @path: socket file name (a stale socket is replaced)
+ *
+ * The socket file is accessible only by the owner.
+ *
+ * Return: listening socket
+ *         -1 - error
+ */
+int daemon_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	mode_t mask;
+	int fd, ret;
+
+	if (set_address(&addr, path))
+		return -1;
+	if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+	mask = umask(077);
+	ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(mask);
+	if (ret || listen(fd, SOMAXCONN)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * receive_request - Read request from connected client
+ * @req: request (`fd` is set)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int receive_request(struct daemon_request *req)
+{
+	struct daemon_header header;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	struct iovec iov = { &header, sizeof(header) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof(control.buf)
+	};
+	struct cmsghdr *cmsg;
+	struct ucred cred;
+	socklen_t credlen = sizeof(cred);
+	char *p, *end, *args;
+	int i;
+
+	if (getsockopt(req->fd, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) ||
+						cred.uid != geteuid())
+		return REQUEST_FAILURE;
+
+	if (recvmsg(req->fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(header))
+		return REQUEST_FAILURE;
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+				cmsg->cmsg_type == SCM_RIGHTS &&
+				cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int))) {
+		int fds[2];
+
+		memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+		req->out = fds[0];
+		req->err = fds[1];
+	}
+	if (req->out < 0 || header.magic != DAEMON_MAGIC || !header.length)
+		return REQUEST_FAILURE;
+
+	req->buf = malloc(header.length + 1);
+	if (!req->buf)
+		return ALLOCATION_FAILURE;
+	if (full_io(req->fd, req->buf, header.length, 0))
+		return REQUEST_FAILURE;
+	req->buf[header.length] = '\0';
+	end = req->buf + header.length;
+
+	if (end[-1] != '\0')
+		return REQUEST_FAILURE;
+
+	/* working directory, environment, and then arguments */
+	req->cwd = req->buf;
+	p = req->buf + strlen(req->buf) + 1;
+	req->env = p;
+	for (; p < end && *p; p += strlen(p) + 1)
+		if (env_name(p) < 0)
+			return REQUEST_FAILURE;
+	if (p++ >= end)
+		return REQUEST_FAILURE;
+	for (args = p; p < end; p += strlen(p) + 1)
+		req->argc++;
+	if (req->argc < 1)
+		return REQUEST_FAILURE;
+	req->argv = malloc((req->argc + 1) * sizeof(*req->argv));
+	if (!req->argv)
+		return ALLOCATION_FAILURE;
+
+	for (i = 0, p = args; i < req->argc; i++, p += strlen(p) + 1)
+		req->argv[i] = p;
+	req->argv[i] = NULL;
+	return set_environment(req->env);
+}
+
+/**
+ * release_request - Close connection, and release request
+ * @req: request
+ */
+static void release_request(struct daemon_request *req)
+{
+	if (req->out >= 0)
+		close(req->out);
+	if (req->err >= 0)
+		close(req->err);
+	close(req->fd);
+	free(req->argv);
+	free(req->buf);
+}
+
+/**
+ * daemon_accept - Wait for a request
+ * @fd:  listening socket
+ * @req: Output. request
+ *
+ * Broken requests, and requests from another user, are dropped.
+ * The passed variables of environment are set to those of the client
+ * (unset if not passed).
+ *
+ * Return: 0 - success
+ *         -1 - error of listening socket
+ */
+int daemon_accept(int fd, struct daemon_request *req)
+{
+	for (;;) {
+		memset(req, '\0', sizeof(*req));
+		req->out = req->err = -1;
+		req->fd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+		if (req->fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return -1;
+		}
+		if (!receive_request(req))
+			return 0;
+		release_request(req);
+	}
+}
+
+/**
+ * daemon_reply - Reply exit status, and release request
+ * @req:    request
+ * @status: exit status of listing
+ */
+void daemon_reply(struct daemon_request *req, int status)
+{
+	int32_t value = status;
+
+	full_io(req->fd, &value, sizeof(value), 1);
+	release_request(req);
+}
+
+/**
+ * daemon_call - Pass listing to daemon, and wait for it
+ * @path: socket file name
+ * @argc: count of arguments
+ * @argv: arguments (including program name)
+ *
+ * Return: exit status of listing
+ *         -1 - daemon cannot be used (nothing is written)
+ *         -2 - daemon is lost while listing (something may be written)
+ */
+int daemon_call(const char *path, int argc, char *argv[])
+{
+	struct sockaddr_un addr;
+	struct daemon_header header = { DAEMON_MAGIC, 0 };
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	struct iovec iov = { &header, sizeof(header) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof(control.buf)
+	};
+	struct cmsghdr *cmsg;
+	int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+	char *cwd, *buf = NULL, *p;
+	const char *value;
+	size_t len;
+	int32_t status = -1;
+	int fd = -1;
+	int i;
+
+	cwd = getcwd(NULL, 0);
+	if (!cwd || set_address(&addr, path))
+		goto out;
+	len = strlen(cwd) + 1;
+	for (i = 0; env_names[i]; i++)
+		if ((value = getenv(env_names[i])))
+			len += strlen(env_names[i]) + strlen(value) + 2;
+	len++;
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+	if (len > UINT32_MAX)
+		goto out;
+	buf = malloc(len);
+	if (!buf)
+		goto out;
+	p = stpcpy(buf, cwd) + 1;
+	for (i = 0; env_names[i]; i++)
+		if ((value = getenv(env_names[i])))
+			p = stpcpy(stpcpy(stpcpy(p, env_names[i]), "="),
+								value) + 1;
+	*p++ = '\0';
+	for (i = 0; i < argc; i++)
+		p = stpcpy(p, argv[i]) + 1;
+	header.length = len;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		goto out;
+
+	memset(control.buf, '\0', sizeof(control.buf));
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(header) ||
+					full_io(fd, buf, len, 1))
+		goto out;
+
+	if (full_io(fd, &status, sizeof(status), 0))
+		status = -2;
+out:
+	if (fd >= 0)
+		close(fd);
+	free(buf);
+	free(cwd);
+	return status;
+}
@@ -0,0 +1,32 @@
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+/**
+ * struct daemon_request - Request of listing from a client.
+ * @fd:   connection to client
+ * @out:  standard output of client
+ * @err:  standard error of client
+ * @cwd:  working directory of client
+ * @env:  environment of client ("NAME=value" strings, up to an empty one)
+ * @argc: count of `argv`
+ * @argv: arguments of client (including program name)
+ * @buf:  received data (`cwd`, `env` and `argv` point into it)
+ */
+struct daemon_request {
+	int fd;
+	int out;
+	int err;
+	const char *cwd;
+	const char *env;
+	int argc;
+	char **argv;
+	char *buf;
+};
+
+/* daemon.c */
+extern int daemon_listen(const char *);
+extern int daemon_accept(int, struct daemon_request *);
+extern void daemon_reply(struct daemon_request *, int);
+extern int daemon_call(const char *, int, char *[]);
+
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file dircache.c
+ * @brief Cache of directory entries, validated by directory status
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_dircache(limit);
+ * 2. names = dircache_get(&dirstat, &len); (NULL if not cached)
+ * 3. dircache_put(&dirstat, names, len); (after reading directory)
+ * 4. clean_dircache();
+ *
+ * Names of a directory are kept as the bytes given by the caller (e.g. a
+ * sequence of names), keyed by (st_dev, st_ino). A cached directory is used only while
+ * its modification and change time are the same: adding, removing or
+ * renaming an entry updates them. A directory modified within the last
+ * second is not cached, since a later change in the same second may not
+ * change the time. When the cache exceeds `limit` bytes, the oldest
+ * directories are dropped. Any thread can call these functions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "dircache.h"
+
+/**
+ * Count of hash buckets (power of 2)
+ */
+#define DIRCACHE_BUCKETS	1024
+
+/**
+ * struct dircache_entry - Cached directory.
+ * @dev:   device of directory
+ * @ino:   inode of directory
+ * @mtim:  modification time, when read
+ * @ctim:  change time, when read
+ * @names: names of entries
+ * @len:   bytes of `names`
+ * @chain: next directory in the same bucket
+ * @older: next directory to be dropped
+ * @newer: previous directory to be dropped
+ */
+struct dircache_entry {
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtim;
+	struct timespec ctim;
+	char *names;
+	size_t len;
+	struct dircache_entry *chain;
+	struct dircache_entry *older;
+	struct dircache_entry *newer;
+};
+
+static struct dircache_entry *buckets[DIRCACHE_BUCKETS];
+/* the newest and oldest cached directory */
+static struct dircache_entry *newest;
+static struct dircache_entry *oldest;
+/* bytes used by the cached names, and its limit */
+static size_t used;
+static size_t limit;
+static pthread_mutex_t dircache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * init_dircache - Enable cache of directory entries
+ * @bytes: maximum bytes of cached names
+ */
+void init_dircache(size_t bytes)
+{
+	limit = bytes;
+}
+
+/**
+ * bucket_of - Hash bucket of directory
+ * @dev: device of directory
+ * @ino: inode of directory
+ *
+ * Return: pointer to bucket
+ */
+static struct dircache_entry **bucket_of(dev_t dev, ino_t ino)
+{
+	uint64_t h = ((uint64_t)dev * 0x9e3779b97f4a7c15ULL) ^ ino;
+
+	h *= 0xff51afd7ed558ccdULL;
+	return &buckets[(h >> 32) & (DIRCACHE_BUCKETS - 1)];
+}
+
+/**
+ * same_time - Compare timespec
+ * @a: timespec
+ * @b: timespec
+ *
+ * Return: true if equal
+ */
+static inline bool same_time(struct timespec a, struct timespec b)
+{
+	return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+/**
+ * drop_locked - Drop directory from cache (`dircache_lock` is held)
+ * @e: cached directory
+ */
+static void drop_locked(struct dircache_entry *e)
+{
+	struct dircache_entry **p = bucket_of(e->dev, e->ino);
+
+	while (*p != e)
+		p = &(*p)->chain;
+	*p = e->chain;
+
+	if (e->newer)
+		e->newer->older = e->older;
+	else
+		newest = e->older;
+	if (e->older)
+		e->older->newer = e->newer;
+	else
+		oldest = e->newer;
+
+	used -= e->len;
+	free(e->names);
+	free(e);
+}
+
+/**
+ * find_locked - Look up directory (`dircache_lock` is held)
+ * @st: status of directory
+ *
+ * Return: cached directory, NULL if none
+ */
+static struct dircache_entry *find_locked(const struct stat *st)
+{
+	struct dircache_entry *e = *bucket_of(st->st_dev, st->st_ino);
+
+	while (e && (e->dev != st->st_dev || e->ino != st->st_ino))
+		e = e->chain;
+	return e;
+}
+
+/**
+ * dircache_get - Copy the names of directory, if cached and unchanged
+ * @st:  status of directory (fstat of opened directory)
+ * @len: Output. bytes of names
+ *
+ * Return: names (release by free()), NULL if not cached
+ */
+char *dircache_get(const struct stat *st, size_t *len)
+{
+	struct dircache_entry *e;
+	char *names = NULL;
+
+	if (!limit)
+		return NULL;
+
+	pthread_mutex_lock(&dircache_lock);
+	e = find_locked(st);
+	if (e && (!same_time(e->mtim, st->st_mtim) ||
+				!same_time(e->ctim, st->st_ctim))) {
+		drop_locked(e);
+		e = NULL;
+	}
+	if (e && (names = malloc(e->len ? e->len : 1))) {
+		memcpy(names, e->names, e->len);
+		*len = e->len;
+	}
+	pthread_mutex_unlock(&dircache_lock);
+	return names;
+}
+
+/**
+ * dircache_put - Cache the names of directory
+ * @st:    status of directory, before it was read
+ * @names: names of entries
+ * @len:   bytes of `names`
+ */
+void dircache_put(const struct stat *st, const char *names, size_t len)
+{
+	struct dircache_entry *e, **bucket;
+	struct timespec now;
+
+	if (!limit || len > limit)
+		return;
+	clock_gettime(CLOCK_REALTIME, &now);
+	if (st->st_mtim.tv_sec >= now.tv_sec - 1 ||
+				st->st_ctim.tv_sec >= now.tv_sec - 1)
+		return;
+
+	e = malloc(sizeof(*e));
+	if (!e)
+		return;
+	e->names = malloc(len ? len : 1);
+	if (!e->names) {
+		free(e);
+		return;
+	}
+	memcpy(e->names, names, len);
+	e->len = len;
+	e->dev = st->st_dev;
+	e->ino = st->st_ino;
+	e->mtim = st->st_mtim;
+	e->ctim = st->st_ctim;
+
+	pthread_mutex_lock(&dircache_lock);
+	if (find_locked(st))
+		drop_locked(find_locked(st));
+	while (oldest && used + len > limit)
+		drop_locked(oldest);
+
+	bucket = bucket_of(e->dev, e->ino);
+	e->chain = *bucket;
+	*bucket = e;
+	e->newer = NULL;
+	e->older = newest;
+	if (newest)
+		newest->newer = e;
+	else
+		oldest = e;
+	newest = e;
+	used += len;
+	pthread_mutex_unlock(&dircache_lock);
+}
+
+/**
+ * clean_dircache - Drop all the cached directories, and disable cache
+ */
+void clean_dircache(void)
+{
+	pthread_mutex_lock(&dircache_lock);
+	while (oldest)
+		drop_locked(oldest);
+	limit = 0;
+	pthread_mutex_unlock(&dircache_lock);
+}
@@ -0,0 +1,10 @@
+#ifndef _DIRCACHE_H
+#define _DIRCACHE_H
+
+/* dircache.c */
+extern void init_dircache(size_t);
+extern char *dircache_get(const struct stat *, size_t *);
+extern void dircache_put(const struct stat *, const char *, size_t);
+extern void clean_dircache(void);
+
+#endif
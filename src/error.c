@@ -3,44 +3,427 @@
  * @brief Error handler
  * @author LeavaTail
  * @date 2019/08/16
+ *
+ * Messages are formatted into a fixed buffer, and appended to a batch
+ * written to stderr by write(2) when it is full, when error_flush() is
+ * called (once for each listed directory), or at exit. If stderr is a
+ * terminal, each message is written at once.
+ * No memory is allocated for a message, and reader threads may report
+ * errors at the same time.
+ *
+ * With init_errors() ("--error-summary"), failures are reported by
+ * error_record() instead. They are counted by (kind, errno, directory),
+ * and printed by error_summary().
+ *
+ * A thread reading a directory ahead ("--prefetch") defers its messages
+ * to a log by error_defer(), and they are written by error_replay() when
+ * the directory is printed, so that they keep their place in the output.
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "pdir.h"
+#include "error.h"
 
 /**
- * ERROR STATUS CODE
- *  1: allocation failed(malloc)
+ * Size of a formatted message. Longer messages are truncated.
  */
-enum
-{
-	ALLOCATION_FAILURE = 1
+#define ERROR_LINE_SIZE		(4096 + 256)
+
+/**
+ * Size of batch written at once
+ */
+#define ERROR_BATCH_SIZE	(16 * 1024)
+
+/**
+ * Count of buckets of failure groups (power of 2)
+ */
+#define ERROR_GROUP_BUCKETS	256
+
+/**
+ * struct error_group - Failures of the same kind, errno and directory.
+ * @what:     kind of failure (e.g. "cannot access"), not copied
+ * @errnum:   errno
+ * @dir:      directory of failed files ("" if none)
+ * @count:    count of failures
+ * @examples: names of the first failures (up to `error_examples`)
+ * @hnext:    next group in the same bucket
+ * @next:     next group, in order of first failure
+ */
+struct error_group {
+	const char *what;
+	int errnum;
+	char *dir;
+	size_t count;
+	char **examples;
+	struct error_group *hnext;
+	struct error_group *next;
 };
 
+/* protects all of the below */
+static pthread_mutex_t error_lock = PTHREAD_MUTEX_INITIALIZER;
+/* formatted message */
+static char error_line[ERROR_LINE_SIZE];
+/* messages not yet written */
+static char error_batch[ERROR_BATCH_SIZE];
+static size_t error_batched;
+/* 0: not yet decided, 1: batched, -1: written at once */
+static int error_batching;
+/* messages of this thread are deferred to this log, NULL if none */
+static __thread struct error_log *error_deferred;
+
+/* "--error-summary": count of examples kept for each group */
+static size_t error_examples;
+static struct error_group *error_buckets[ERROR_GROUP_BUCKETS];
+static struct error_group *error_first;
+static struct error_group **error_last = &error_first;
+/* failures which cannot be grouped (allocation failed) */
+static size_t error_dropped;
+
 /**
- * error - Output error message
- * @status: status code
- * @message: output message (variable length)
+ * write_all - Write buffer to stderr
+ * @buf: data
+ * @len: length of `buf`
+ */
+static void write_all(const char *buf, size_t len)
+{
+	while (len) {
+		ssize_t n = write(STDERR_FILENO, buf, len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/**
+ * flush_locked - Write batched messages (`error_lock` is held)
  */
-void error(int status, const char *message, ...)
+static void flush_locked(void)
 {
-	va_list args, copy;
-	size_t length;
-	char *buffer;
+	write_all(error_batch, error_batched);
+	error_batched = 0;
+}
 
-	va_start (args, message);
-	/* calculate variable message length */
-	va_copy(copy, args);
-	length = vsnprintf(NULL, 0, message, copy);
+/**
+ * error_flush - Write batched messages to stderr
+ *
+ * Called at exit, and before anything is written to stderr by stdio.
+ */
+void error_flush(void)
+{
+	int saved = errno;
 
-	/* store variable message to string */
-	buffer = malloc((length + 1) * sizeof(char));
-	if (buffer) {
-		vsnprintf(buffer, length + 1, message, args);
-		perror(buffer);
+	pthread_mutex_lock(&error_lock);
+	flush_locked();
+	pthread_mutex_unlock(&error_lock);
+	errno = saved;
+}
 
-		free(buffer);
+/**
+ * append_locked - Append message to batch (`error_lock` is held)
+ * @buf: message
+ * @len: length of `buf`
+ */
+static void append_locked(const char *buf, size_t len)
+{
+	if (!error_batching) {
+		error_batching = isatty(STDERR_FILENO) ? -1 : 1;
+		if (error_batching > 0)
+			atexit(error_flush);
 	}
 
+	if (error_batched + len > sizeof(error_batch))
+		flush_locked();
+	if (len > sizeof(error_batch) || error_batching < 0) {
+		write_all(buf, len);
+		return;
+	}
+	memcpy(error_batch + error_batched, buf, len);
+	error_batched += len;
+}
+
+/**
+ * defer_locked - Append message to the log of this thread
+ * @buf: message
+ * @len: length of `buf`
+ *
+ * Return: true  - message is deferred
+ *         false - log cannot grow (message should be written now)
+ */
+static bool defer_locked(const char *buf, size_t len)
+{
+	struct error_log *log = error_deferred;
+
+	if (log->len + len > log->size) {
+		size_t newsize = log->size ? log->size * 2 : 1024;
+		char *p;
+
+		while (newsize < log->len + len)
+			newsize *= 2;
+		p = realloc(log->buf, newsize);
+		if (!p)
+			return false;
+		log->buf = p;
+		log->size = newsize;
+	}
+	memcpy(log->buf + log->len, buf, len);
+	log->len += len;
+	return true;
+}
+
+/**
+ * vformat_locked - Format message into `error_line` (`error_lock` is held)
+ * @errnum:  errno to be described (0 for none)
+ * @message: format
+ * @args:    arguments of `message`
+ *
+ * Return: length of formatted message (terminated by newline)
+ */
+static size_t vformat_locked(int errnum, const char *message, va_list args)
+{
+	size_t size = sizeof(error_line) - 1;
+	size_t len;
+	int ret;
+
+	ret = vsnprintf(error_line, size, message, args);
+	len = ret < 0 ? 0 : (ret < size ? ret : size - 1);
+	if (errnum) {
+		ret = snprintf(error_line + len, size - len, ": %s",
+							strerror(errnum));
+		len += ret < 0 ? 0 : (ret < size - len ? ret : size - len - 1);
+	}
+	error_line[len++] = '\n';
+	return len;
+}
+
+/**
+ * format_locked - vformat_locked() with variable arguments
+ * @errnum:  errno to be described (0 for none)
+ * @message: format
+ *
+ * Return: length of formatted message (terminated by newline)
+ */
+static size_t format_locked(int errnum, const char *message, ...)
+{
+	va_list args;
+	size_t len;
+
+	va_start(args, message);
+	len = vformat_locked(errnum, message, args);
 	va_end(args);
+	return len;
+}
+
+/**
+ * error - Output error message (like error(3), without exiting)
+ * @errnum:  errno to be described (0 for none)
+ * @message: output message (variable length)
+ */
+void error(int errnum, const char *message, ...)
+{
+	int saved = errno;
+	va_list args;
+	size_t len;
+
+	pthread_mutex_lock(&error_lock);
+	va_start(args, message);
+	len = vformat_locked(errnum, message, args);
+	va_end(args);
+	if (!error_deferred || !defer_locked(error_line, len))
+		append_locked(error_line, len);
+	pthread_mutex_unlock(&error_lock);
+	errno = saved;
+}
+
+/**
+ * error_pending - Check whether messages are batched
+ *
+ * Return: true if some messages are not yet written
+ */
+bool error_pending(void)
+{
+	bool ret;
+
+	pthread_mutex_lock(&error_lock);
+	ret = error_batched != 0;
+	pthread_mutex_unlock(&error_lock);
+	return ret;
+}
+
+/**
+ * error_defer - Defer the messages of this thread to log
+ * @log: log (empty), NULL to stop deferring
+ */
+void error_defer(struct error_log *log)
+{
+	error_deferred = log;
+}
+
+/**
+ * error_replay - Output the messages deferred to log, and release it
+ * @log: log
+ */
+void error_replay(struct error_log *log)
+{
+	if (log->len) {
+		pthread_mutex_lock(&error_lock);
+		append_locked(log->buf, log->len);
+		pthread_mutex_unlock(&error_lock);
+	}
+	free(log->buf);
+	memset(log, '\0', sizeof(*log));
+}
+
+/**
+ * init_errors - Aggregate failures instead of printing ("--error-summary")
+ * @examples: count of file names printed for each group
+ */
+void init_errors(size_t examples)
+{
+	error_examples = examples;
+}
+
+/**
+ * hash_group - Hash of group key
+ * @what:   kind of failure
+ * @errnum: errno
+ * @dir:    directory name
+ *
+ * Return: bucket index
+ */
+static size_t hash_group(const char *what, int errnum, const char *dir)
+{
+	/* FNV-1a */
+	size_t h = 2166136261u ^ (size_t)errnum;
+
+	while (*what)
+		h = (h ^ (unsigned char)*what++) * 16777619u;
+	while (*dir)
+		h = (h ^ (unsigned char)*dir++) * 16777619u;
+	return h & (ERROR_GROUP_BUCKETS - 1);
+}
+
+/**
+ * find_group - Find (or add) group of failure (`error_lock` is held)
+ * @what:   kind of failure
+ * @errnum: errno
+ * @dir:    directory name
+ *
+ * Return: group, or NULL if it cannot be allocated
+ */
+static struct error_group *find_group(const char *what, int errnum,
+							const char *dir)
+{
+	size_t h = hash_group(what, errnum, dir);
+	struct error_group *g;
+
+	for (g = error_buckets[h]; g; g = g->hnext)
+		if (g->errnum == errnum && !strcmp(g->what, what) &&
+						!strcmp(g->dir, dir))
+			return g;
+
+	g = calloc(1, sizeof(*g));
+	if (!g)
+		return NULL;
+	g->dir = strdup(dir);
+	g->examples = calloc(error_examples + 1, sizeof(*g->examples));
+	if (!g->dir || !g->examples) {
+		free(g->examples);
+		free(g->dir);
+		free(g);
+		return NULL;
+	}
+	g->what = what;
+	g->errnum = errnum;
+	g->hnext = error_buckets[h];
+	error_buckets[h] = g;
+	*error_last = g;
+	error_last = &g->next;
+	return g;
+}
+
+/**
+ * error_record - Count a failure on a file ("--error-summary")
+ * @errnum: errno describing the failure (0 for none)
+ * @what:   kind of failure (e.g. "cannot access")
+ * @dir:    directory of file ("" if none)
+ * @name:   file name
+ */
+void error_record(int errnum, const char *what, const char *dir,
+							const char *name)
+{
+	int saved = errno;
+	struct error_group *g;
+
+	pthread_mutex_lock(&error_lock);
+	g = find_group(what, errnum, dir);
+	if (!g) {
+		error_dropped++;
+		goto out;
+	}
+	if (g->count < error_examples)
+		g->examples[g->count] = strdup(name);
+	g->count++;
+out:
+	pthread_mutex_unlock(&error_lock);
+	errno = saved;
+}
+
+/**
+ * error_summary - Print and release groups of failures
+ *
+ * Each group is printed as "PROGRAM: WHAT (STRERROR): COUNT in 'DIR'"
+ * ("(STRERROR)" only if errno is given), followed by its first file
+ * names, in order of first failure.
+ */
+void error_summary(void)
+{
+	struct error_group *g, *next;
+	size_t i, len;
+
+	pthread_mutex_lock(&error_lock);
+	for (g = error_first; g; g = next) {
+		next = g->next;
+		len = format_locked(0, "%s: %s%s%s%s: %zu%s%s%s", PROGRAM_NAME,
+				g->what, g->errnum ? " (" : "",
+				g->errnum ? strerror(g->errnum) : "",
+				g->errnum ? ")" : "", g->count,
+				g->dir[0] ? " in '" : "", g->dir,
+				g->dir[0] ? "'" : "");
+		append_locked(error_line, len);
+		for (i = 0; i < error_examples && g->examples[i]; i++) {
+			len = format_locked(0, "  %s", g->examples[i]);
+			append_locked(error_line, len);
+			free(g->examples[i]);
+		}
+		if (g->count > i) {
+			len = format_locked(0, "  ...");
+			append_locked(error_line, len);
+		}
+		free(g->examples);
+		free(g->dir);
+		free(g);
+	}
+	if (error_dropped) {
+		len = format_locked(0, "%s: %zu more failures", PROGRAM_NAME,
+							error_dropped);
+		append_locked(error_line, len);
+	}
+	memset(error_buckets, '\0', sizeof(error_buckets));
+	error_first = NULL;
+	error_last = &error_first;
+	error_dropped = 0;
+	flush_locked();
+	pthread_mutex_unlock(&error_lock);
 }
@@ -1,6 +1,28 @@
 #ifndef _ERROR_H
 #define _ERROR_H
 
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * struct error_log - Messages deferred by a thread.
+ * @buf:  messages (each terminated by newline)
+ * @len:  length of `buf`
+ * @size: allocated bytes of `buf`
+ */
+struct error_log {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
 /* error.c */
 extern void error(int, const char *, ...);
+extern void error_flush(void);
+extern bool error_pending(void);
+extern void error_defer(struct error_log *);
+extern void error_replay(struct error_log *);
+extern void init_errors(size_t);
+extern void error_record(int, const char *, const char *, const char *);
+extern void error_summary(void);
 #endif
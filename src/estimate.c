@@ -0,0 +1,186 @@
+/**
+ * @file estimate.c
+ * @brief Random sample of directory entries, and estimated totals
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_sample(&sample, capacity);
+ * 2. sample_add(&sample, name); (for each entry of directory)
+ * 3. sample_add_value(&sum, value); (for each of sample.names)
+ * 4. total = sample_total(&sum, n, sample.seen, &bound);
+ * 5. clear_sample(&sample); (for next directory)
+ * 6. clean_sample(&sample);
+ *
+ * Names are sampled by reservoir sampling (Algorithm R): each name of
+ * the stream is in the sample with the same probability, without knowing
+ * the length of the stream in advance. Totals are extrapolated from the
+ * mean of the sample, with the bounds of the normal approximation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "estimate.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1
+};
+
+/**
+ * Seed of random number generator. Fixed, so that the same directory
+ * gives the same estimate.
+ */
+#define SAMPLE_SEED	0x9e3779b97f4a7c15ULL
+
+/**
+ * sample_random - Next random number (xorshift64*)
+ * @s: sample
+ *
+ * Return: random number
+ */
+static uint64_t sample_random(struct sample *s)
+{
+	s->rand ^= s->rand >> 12;
+	s->rand ^= s->rand << 25;
+	s->rand ^= s->rand >> 27;
+	return s->rand * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * init_sample - Initialize sample
+ * @s:        sample
+ * @capacity: maximum count of sampled names (at least 1)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int init_sample(struct sample *s, size_t capacity)
+{
+	memset(s, '\0', sizeof(*s));
+	s->names = malloc(capacity * sizeof(*s->names));
+	if (!s->names)
+		return ALLOCATION_FAILURE;
+	s->capacity = capacity;
+	s->rand = SAMPLE_SEED;
+	return 0;
+}
+
+/**
+ * clear_sample - Remove all the names, to sample another stream
+ * @s: sample
+ */
+void clear_sample(struct sample *s)
+{
+	size_t i;
+
+	for (i = 0; i < s->count; i++)
+		free(s->names[i]);
+	s->count = 0;
+	s->seen = 0;
+	s->rand = SAMPLE_SEED;
+}
+
+/**
+ * sample_add - Add a name of the stream
+ * @s:    sample
+ * @name: name (copied if sampled)
+ *
+ * The first `capacity` names are sampled. After that, the n-th name
+ * replaces a random one of the sample with probability capacity / n.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int sample_add(struct sample *s, const char *name)
+{
+	uint64_t i;
+	char *copy;
+
+	s->seen++;
+	if (s->count < s->capacity) {
+		i = s->count;
+	} else {
+		i = sample_random(s) % s->seen;
+		if (i >= s->capacity)
+			return 0;
+	}
+
+	copy = strdup(name);
+	if (!copy)
+		return ALLOCATION_FAILURE;
+	if (i < s->count)
+		free(s->names[i]);
+	else
+		s->count++;
+	s->names[i] = copy;
+	return 0;
+}
+
+/**
+ * clean_sample - Release sample
+ * @s: sample
+ */
+void clean_sample(struct sample *s)
+{
+	clear_sample(s);
+	free(s->names);
+	s->names = NULL;
+}
+
+/**
+ * sample_add_value - Add a value of a sampled entry
+ * @sum: sum of the quantity
+ * @v:   value (1 or 0, to count entries of a class)
+ */
+void sample_add_value(struct sample_sum *sum, double v)
+{
+	sum->sum += v;
+	sum->sumsq += v * v;
+}
+
+/**
+ * sample_total - Estimate the total of a quantity over the stream
+ * @sum:        sum of the quantity over the sample
+ * @n:          count of values in `sum`
+ * @population: count of entries in the stream
+ * @bound:      Output. half width of the ESTIMATE_Z confidence interval
+ *              (0 if all entries are in the sample, -1 if unknown)
+ *
+ * The variance is corrected for sampling without replacement from a
+ * finite stream (1 - n / population).
+ *
+ * Return: estimated total
+ */
+double sample_total(const struct sample_sum *sum, size_t n,
+				uint64_t population, double *bound)
+{
+	double mean, var;
+
+	if (!n) {
+		*bound = population ? -1 : 0;
+		return 0;
+	}
+	mean = sum->sum / n;
+	if (n >= population) {
+		*bound = 0;
+		return sum->sum;
+	}
+	if (n < 2) {
+		*bound = -1;
+		return mean * population;
+	}
+
+	var = (sum->sumsq - sum->sum * mean) / (n - 1);
+	if (var < 0)
+		var = 0;
+	*bound = ESTIMATE_Z * population *
+		sqrt(var / n * (1 - (double)n / population));
+	return mean * population;
+}
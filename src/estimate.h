@@ -0,0 +1,47 @@
+#ifndef _ESTIMATE_H
+#define _ESTIMATE_H
+
+#include <stdint.h>
+
+/**
+ * Critical value of the standard normal distribution for the confidence
+ * bounds (95%).
+ */
+#define ESTIMATE_Z	1.96
+
+/**
+ * struct sample - Reservoir of names, sampled uniformly from a stream.
+ * @names:    sampled names (`count` of them)
+ * @capacity: maximum count of `names`
+ * @count:    count of `names`
+ * @seen:     count of names added to the stream
+ * @rand:     state of random number generator
+ */
+struct sample {
+	char **names;
+	size_t capacity;
+	size_t count;
+	uint64_t seen;
+	uint64_t rand;
+};
+
+/**
+ * struct sample_sum - Sum of a quantity over the sampled entries.
+ * @sum:   sum of values
+ * @sumsq: sum of squared values
+ */
+struct sample_sum {
+	double sum;
+	double sumsq;
+};
+
+/* estimate.c */
+extern int init_sample(struct sample *, size_t);
+extern void clear_sample(struct sample *);
+extern int sample_add(struct sample *, const char *);
+extern void clean_sample(struct sample *);
+extern void sample_add_value(struct sample_sum *, double);
+extern double sample_total(const struct sample_sum *, size_t, uint64_t,
+								double *);
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file filter.c
+ * @brief find-style predicates on type, age and size of entries
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_filter(&filter);
+ * 2. filter_add_types(&filter, "f,l"); (and set age and size)
+ * 3. filter_dtype(&filter, d_type); (before status is read)
+ * 4. filter_status(&filter, &status); (after status is read)
+ *
+ * Types are answered from d_type of readdir(), so that entries of other
+ * types are dropped without reading their status. Only the entries whose
+ * d_type is DT_UNKNOWN are checked by their status.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include "filter.h"
+
+/**
+ * ERROR STATUS CODE
+ *  3: argument pointer is illegal
+ */
+enum
+{
+	ILLEGAL_ARGUMENT_FAILURE = 3
+};
+
+/**
+ * struct type_letter - Letter of file type ('--type').
+ * @letter: letter (same as find -type)
+ * @dtype:  type of d_type
+ */
+static const struct type_letter {
+	char letter;
+	unsigned char dtype;
+} type_letters[] =
+{
+	{'b', DT_BLK},
+	{'c', DT_CHR},
+	{'d', DT_DIR},
+	{'f', DT_REG},
+	{'l', DT_LNK},
+	{'p', DT_FIFO},
+	{'s', DT_SOCK},
+	{'\0', DT_UNKNOWN}
+};
+
+/**
+ * init_filter - Initialize filter, listing every entry
+ * @f: filter
+ */
+void init_filter(struct filter *f)
+{
+	memset(f, '\0', sizeof(*f));
+	f->max_size = UINT64_MAX;
+}
+
+/**
+ * filter_add_types - Add file types to be listed
+ * @f:       filter
+ * @letters: letters of types, separated by ',' (e.g. "f,l")
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int filter_add_types(struct filter *f, const char *letters)
+{
+	const struct type_letter *t;
+
+	do {
+		for (t = type_letters; t->letter; t++)
+			if (t->letter == *letters)
+				break;
+		if (!t->letter || (letters[1] != ',' && letters[1] != '\0'))
+			return ILLEGAL_ARGUMENT_FAILURE;
+		f->types |= 1u << t->dtype;
+		letters++;
+	} while (*letters++ == ',');
+	return 0;
+}
+
+/**
+ * filter_enabled - Check that filter drops any entry
+ * @f: filter
+ *
+ * Return: true if any predicate is set
+ */
+bool filter_enabled(const struct filter *f)
+{
+	return f->types || f->has_newer || f->has_older ||
+			f->min_size || f->max_size != UINT64_MAX;
+}
+
+/**
+ * filter_dtype - Check type of entry, before its status is read
+ * @f:     filter
+ * @dtype: d_type of entry
+ *
+ * Return: false if the entry is not listed
+ *         true  - listed, or not known until status is read
+ */
+bool filter_dtype(const struct filter *f, unsigned char dtype)
+{
+	return !f->types || dtype == DT_UNKNOWN || (f->types & (1u << dtype));
+}
+
+/**
+ * timespec_before - compare timespec
+ * @a: timespec
+ * @b: timespec
+ *
+ * Return: true if `a` is earlier than `b`
+ */
+static inline bool timespec_before(struct timespec a, struct timespec b)
+{
+	return a.tv_sec < b.tv_sec ||
+		(a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+/**
+ * filter_status - Check status of entry
+ * @f:  filter
+ * @st: status of entry (not following symbolic link)
+ *
+ * Return: true if the entry is listed
+ */
+bool filter_status(const struct filter *f, const struct stat *st)
+{
+	uint64_t size = st->st_size;
+
+	if (f->types && !(f->types & (1u << IFTODT(st->st_mode))))
+		return false;
+	if (f->has_newer && !timespec_before(f->newer, st->st_mtim))
+		return false;
+	if (f->has_older && !timespec_before(st->st_mtim, f->older))
+		return false;
+	return size >= f->min_size && size <= f->max_size;
+}
@@ -0,0 +1,36 @@
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/**
+ * struct filter - find-style predicates on directory entries.
+ * @types:     mask of listed file types (1 << DT_*), 0 means all
+ * @has_newer: `newer` is set
+ * @newer:     listed if modified after this time
+ * @has_older: `older` is set
+ * @older:     listed if modified before this time
+ * @min_size:  listed if at least this size
+ * @max_size:  listed if at most this size
+ */
+struct filter {
+	unsigned int types;
+	bool has_newer;
+	struct timespec newer;
+	bool has_older;
+	struct timespec older;
+	uint64_t min_size;
+	uint64_t max_size;
+};
+
+/* filter.c */
+extern void init_filter(struct filter *);
+extern int filter_add_types(struct filter *, const char *);
+extern bool filter_enabled(const struct filter *);
+extern bool filter_dtype(const struct filter *, unsigned char);
+extern bool filter_status(const struct filter *, const struct stat *);
+
+#endif
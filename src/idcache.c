@@ -0,0 +1,221 @@
+/**
+ * @file idcache.c
+ * @brief Cache of user/group names
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. name = getuser(uid); (or getgroup(gid))
+ * 2. clean_idcache();
+ *
+ * getpwuid()/getgrgid() are neither cheap nor thread-safe, and a listing
+ * asks for the same few ids over and over. The names are looked up once
+ * with the reentrant functions and kept until clean_idcache().
+ * All functions can be called from any thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/types.h>
+#include "idcache.h"
+
+/**
+ * Buffer size for getpwuid_r()/getgrgid_r() (expand as needed)
+ */
+#define IDCACHE_BUFSIZE	1024
+
+/**
+ * struct idcache_entry - Cached name of user-id or group-id.
+ * @id:   user-id or group-id
+ * @name: name, NULL if id has no name
+ * @next: next entry
+ */
+struct idcache_entry {
+	unsigned long id;
+	char *name;
+	struct idcache_entry *next;
+};
+
+/* cached users and groups */
+static struct idcache_entry *user_alist;
+static struct idcache_entry *group_alist;
+static pthread_mutex_t idcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * lookup_user - get user name from passwd database
+ * @uid: user-id
+ *
+ * Return: allocated name, NULL if not found
+ */
+static char *lookup_user(uid_t uid)
+{
+	struct passwd pwd, *result = NULL;
+	size_t size = IDCACHE_BUFSIZE;
+	char *buf = NULL, *name = NULL;
+	int err;
+
+	do {
+		char *tmp = realloc(buf, size);
+		if (!tmp)
+			goto out;
+		buf = tmp;
+		err = getpwuid_r(uid, &pwd, buf, size, &result);
+		size *= 2;
+	} while (err == ERANGE);
+
+	if (!err && result)
+		name = strdup(result->pw_name);
+out:
+	free(buf);
+	return name;
+}
+
+/**
+ * lookup_group - get group name from group database
+ * @gid: group-id
+ *
+ * Return: allocated name, NULL if not found
+ */
+static char *lookup_group(gid_t gid)
+{
+	struct group grp, *result = NULL;
+	size_t size = IDCACHE_BUFSIZE;
+	char *buf = NULL, *name = NULL;
+	int err;
+
+	do {
+		char *tmp = realloc(buf, size);
+		if (!tmp)
+			goto out;
+		buf = tmp;
+		err = getgrgid_r(gid, &grp, buf, size, &result);
+		size *= 2;
+	} while (err == ERANGE);
+
+	if (!err && result)
+		name = strdup(result->gr_name);
+out:
+	free(buf);
+	return name;
+}
+
+/**
+ * find_entry - search cached id, move it to front
+ * @alist: cache list
+ * @id:    user-id or group-id
+ *
+ * Return: cache entry, NULL if not cached
+ */
+static struct idcache_entry *find_entry(struct idcache_entry **alist,
+							unsigned long id)
+{
+	struct idcache_entry **pos, *entry;
+
+	for (pos = alist; *pos; pos = &(*pos)->next) {
+		entry = *pos;
+		if (entry->id == id) {
+			*pos = entry->next;
+			entry->next = *alist;
+			*alist = entry;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * add_entry - cache name of id
+ * @alist: cache list
+ * @id:    user-id or group-id
+ * @name:  allocated name (or NULL)
+ *
+ * Return: cached name (or NULL)
+ */
+static const char *add_entry(struct idcache_entry **alist,
+				unsigned long id, char *name)
+{
+	struct idcache_entry *entry = malloc(sizeof(*entry));
+
+	/* Not cached, but still answered */
+	if (!entry)
+		return name;
+
+	entry->id = id;
+	entry->name = name;
+	entry->next = *alist;
+	*alist = entry;
+	return name;
+}
+
+/**
+ * getuser - get user name of uid
+ * @uid: user-id
+ *
+ * Return: user name, NULL if uid has no name.
+ */
+const char *getuser(uid_t uid)
+{
+	struct idcache_entry *entry;
+	const char *name;
+
+	pthread_mutex_lock(&idcache_lock);
+	entry = find_entry(&user_alist, uid);
+	if (entry)
+		name = entry->name;
+	else
+		name = add_entry(&user_alist, uid, lookup_user(uid));
+	pthread_mutex_unlock(&idcache_lock);
+	return name;
+}
+
+/**
+ * getgroup - get group name of gid
+ * @gid: group-id
+ *
+ * Return: group name, NULL if gid has no name.
+ */
+const char *getgroup(gid_t gid)
+{
+	struct idcache_entry *entry;
+	const char *name;
+
+	pthread_mutex_lock(&idcache_lock);
+	entry = find_entry(&group_alist, gid);
+	if (entry)
+		name = entry->name;
+	else
+		name = add_entry(&group_alist, gid, lookup_group(gid));
+	pthread_mutex_unlock(&idcache_lock);
+	return name;
+}
+
+/**
+ * free_alist - release cache list
+ * @alist: cache list
+ */
+static void free_alist(struct idcache_entry **alist)
+{
+	struct idcache_entry *entry, *next;
+
+	for (entry = *alist; entry; entry = next) {
+		next = entry->next;
+		free(entry->name);
+		free(entry);
+	}
+	*alist = NULL;
+}
+
+/**
+ * clean_idcache - clean up cached names
+ */
+void clean_idcache(void)
+{
+	pthread_mutex_lock(&idcache_lock);
+	free_alist(&user_alist);
+	free_alist(&group_alist);
+	pthread_mutex_unlock(&idcache_lock);
+}
@@ -0,0 +1,9 @@
+#ifndef _IDCACHE_H
+#define _IDCACHE_H
+
+/* idcache.c */
+extern const char *getuser(uid_t);
+extern const char *getgroup(gid_t);
+extern void clean_idcache(void);
+
+#endif
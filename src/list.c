@@ -71,19 +71,20 @@ static size_t count;
  * init_list - Initialize linked-list
  *
  * linked-list `head` Initialize.(allocation, next/prev pointer set)
- * If Failure allocation, cause normal process termination.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
  */
-void init_list(void)
+int init_list(void)
 {
 	list_head *dummy = malloc(sizeof(*dummy));
-	if (!dummy) {
-		perror("Initialize linked-list");
-		exit(ALLOCATION_FAILURE);
-	}
+	if (!dummy)
+		return ALLOCATION_FAILURE;
 	count = 0;
 	dummy->next = dummy;
 	dummy->prev = dummy;
 	head = dummy;
+	return 0;
 }
 
 /**
@@ -134,17 +135,46 @@ out:
 /**
  * clean_list - clean up linked-list
  *
- * clean up linked-list.
+ * clean up linked-list. Nothing is done if it is not initialized.
  * WARN: Be sure clean up list when use linked list.
  */
 void clean_list(void)
 {
-	list_head *cursor;
-	list_for_each(cursor, head) {
+	list_head *cursor, *next;
+
+	if (!head)
+		return;
+	for (cursor = head->next; cursor != head; cursor = next) {
+		next = cursor->next;
 		free(cursor->data);
 		free(cursor);
 	}
 	free(head);
+	head = NULL;
+	count = 0;
+}
+
+/**
+ * walk_list - call function for each data in linked-list.
+ * @fn:  called with data, its length and `arg` (non-zero stops walking)
+ * @arg: passed to `fn`
+ *
+ * Data is visited in the order of `get_list()` (FIFO), and not removed.
+ *
+ * Return: 0 - success
+ *         otherwise - return value of `fn`
+ */
+int walk_list(int (*fn)(const void *, size_t, void *), void *arg)
+{
+	int ret = 0;
+	list_head *cursor;
+
+	list_for_each_reverse(cursor, head) {
+		ret = fn(cursor->data, cursor->len, arg);
+		if (ret)
+			break;
+	}
+	return ret;
 }
 
 /**
@@ -2,11 +2,12 @@
 #define _LIST_H
 
 /* list.c */
-extern void init_list(void);
+extern int init_list(void);
 extern int add_list(void *, size_t);
 extern void clean_list(void);
 extern size_t get_length(void);
 extern size_t get_listcount(void);
 extern int get_list(void *, size_t);
+extern int walk_list(int (*)(const void *, size_t, void *), void *);
 
 #endif
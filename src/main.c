@@ -10,17 +10,77 @@
 #include <config.h>
 #include <getopt.h>
 #include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include <dirent.h>
-#include <pwd.h>
-#include <grp.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <locale.h>
+#include <setjmp.h>
+#include <signal.h>
 #include "pdir.h"
 #include "gettext.h"
 #include "error.h"
 #include "list.h"
+#include "pattern.h"
+#include "spill.h"
+#include "idcache.h"
+#include "pipeline.h"
+#include "color.h"
+#include "timedstat.h"
+#include "visited.h"
+#include "snapshot.h"
+#include "psort.h"
+#include "writer.h"
+#include "checkpoint.h"
+#include "estimate.h"
+#include "daemon.h"
+#include "dircache.h"
+#include "trace.h"
+#include "quote.h"
+#include "filter.h"
+#include "xattr.h"
+#include "version.h"
+#include "ratelimit.h"
+
+/* message catalog is loaded (again for each request of '--daemon') */
+static bool messages_loaded;
+
+/**
+ * init_messages - Load message catalog, before the first message
+ *
+ * Most listings print no message, so that the locale and the message
+ * catalog are loaded only when a message is translated. Only the
+ * categories of messages are set (LC_CTYPE for the character set, and
+ * LC_MESSAGES). setlocale() is not thread-safe: call this before
+ * starting threads which may report failures ('--prefetch').
+ */
+static void init_messages(void)
+{
+	if (messages_loaded)
+		return;
+	messages_loaded = true;
+	setlocale (LC_CTYPE, "");
+	setlocale (LC_MESSAGES, "");
+	bindtextdomain (PACKAGE, LOCALEDIR);
+	textdomain (PACKAGE);
+}
+
+/**
+ * translate - Translate message (loading message catalog if not yet)
+ * @msgid: message
+ *
+ * Return: translated message
+ */
+static inline const char *translate(const char *msgid)
+{
+	init_messages();
+	return gettext (msgid);
+}
 
 /**
  * Be written to support message catalogs
@@ -28,7 +88,7 @@
  *   printf(_(MESSAGE));
  *   perror(_(MESSAGE));
  */
-#define _(String) gettext (String)
+#define _(String) translate (String)
 
 /**
  * Special Option(no short option)
@@ -36,9 +96,57 @@
 enum
 {
 	GETOPT_HELP_CHAR = (CHAR_MIN - 2),
-	GETOPT_VERSION_CHAR = (CHAR_MIN - 3)
+	GETOPT_VERSION_CHAR = (CHAR_MIN - 3),
+	GETOPT_HIDE_CHAR = (CHAR_MIN - 4),
+	GETOPT_MEMORY_LIMIT_CHAR = (CHAR_MIN - 5),
+	GETOPT_PREFETCH_CHAR = (CHAR_MIN - 6),
+	GETOPT_HEAD_CHAR = (CHAR_MIN - 7),
+	GETOPT_TAIL_CHAR = (CHAR_MIN - 8),
+	GETOPT_COLOR_CHAR = (CHAR_MIN - 9),
+	GETOPT_STAT_TIMEOUT_CHAR = (CHAR_MIN - 10),
+	GETOPT_DEDUPE_CHAR = (CHAR_MIN - 11),
+	GETOPT_SAVE_SNAPSHOT_CHAR = (CHAR_MIN - 12),
+	GETOPT_DIFF_SNAPSHOT_CHAR = (CHAR_MIN - 13),
+	GETOPT_ERROR_SUMMARY_CHAR = (CHAR_MIN - 14),
+	GETOPT_ASYNC_OUTPUT_CHAR = (CHAR_MIN - 15),
+	GETOPT_CHECKPOINT_CHAR = (CHAR_MIN - 16),
+	GETOPT_RESUME_CHAR = (CHAR_MIN - 17),
+	GETOPT_ESTIMATE_CHAR = (CHAR_MIN - 18),
+	GETOPT_MERGE_CHAR = (CHAR_MIN - 19),
+	GETOPT_DAEMON_CHAR = (CHAR_MIN - 20),
+	GETOPT_CONNECT_CHAR = (CHAR_MIN - 21),
+	GETOPT_TRACE_CHAR = (CHAR_MIN - 22),
+	GETOPT_SHOW_CONTROL_CHARS_CHAR = (CHAR_MIN - 23),
+	GETOPT_QUOTING_STYLE_CHAR = (CHAR_MIN - 24),
+	GETOPT_TYPE_CHAR = (CHAR_MIN - 25),
+	GETOPT_NEWER_THAN_CHAR = (CHAR_MIN - 26),
+	GETOPT_OLDER_THAN_CHAR = (CHAR_MIN - 27),
+	GETOPT_MIN_SIZE_CHAR = (CHAR_MIN - 28),
+	GETOPT_MAX_SIZE_CHAR = (CHAR_MIN - 29),
+	GETOPT_XATTR_CHAR = (CHAR_MIN - 30),
+	GETOPT_MAX_IOPS_CHAR = (CHAR_MIN - 31),
+	GETOPT_STATS_CHAR = (CHAR_MIN - 32)
 };
 
+/* "--daemon" option. request being served, NULL if none */
+static jmp_buf *request_exit;
+static int request_status;
+
+/**
+ * leave - exit() with status, or end the request being served
+ * @status: Status code
+ *
+ * While '--daemon' serves a request, only the request is ended.
+ */
+static void leave(int status)
+{
+	if (request_exit) {
+		request_status = status;
+		longjmp(*request_exit, 1);
+	}
+	exit(status);
+}
+
 /**
  * usage - print out usage.
  * @status: Status code
@@ -56,7 +164,7 @@ void usage(int status)
 	fprintf(out, _("Usage: %s [OPTION]... [FILE]...\n"),
 										PROGRAM_NAME);
 
-	exit(status);
+	leave(status);
 }
 
 /**
@@ -68,17 +176,73 @@ static void file_failure (int status, char const *name)
 {
 	switch (status) {
 	case ALLOCATION_FAILURE:
-		error(status, _("%s: cannot allocate memory"), PROGRAM_NAME);
+		error(errno, _("%s: cannot allocate memory"), PROGRAM_NAME);
+		break;
+	case ACCESS_FAILURE:
+		error(errno, _("%s: cannot access '%s'"), PROGRAM_NAME, name);
+		break;
+	case OPENDIRECTRY_FAILURE:
+		error(errno, _("%s: cannot open directory '%s'"), PROGRAM_NAME, name);
+		break;
+	case SPILL_FAILURE:
+		error(errno, _("%s: cannot use temporary file"), PROGRAM_NAME);
+		break;
+	case SNAPSHOT_FAILURE:
+		error(errno, _("%s: cannot use snapshot '%s'"), PROGRAM_NAME, name);
 		break;
+	case CHECKPOINT_FAILURE:
+		error(errno, _("%s: cannot use checkpoint '%s'"), PROGRAM_NAME, name);
+		break;
+	case DAEMON_FAILURE:
+		error(errno, _("%s: cannot use socket '%s'"), PROGRAM_NAME, name);
+		break;
+	case TRACE_FAILURE:
+		error(errno, _("%s: cannot write trace '%s'"), PROGRAM_NAME, name);
+		break;
+	}
+}
+
+/* "--error-summary" option. aggregate failures on files */
+static bool summarize_errors;
+
+/**
+ * entry_failure - Report the failure on a file in directory
+ * @status:  Status code (ACCESS_FAILURE or OPENDIRECTRY_FAILURE)
+ * @dirname: Base direcotry name ("" if none)
+ * @path:    File name, including `dirname`
+ *
+ * With '--error-summary', the failure is counted by its kind, errno and
+ * directory, instead of being printed.
+ */
+static void entry_failure(int status, char const *dirname, char const *path)
+{
+	if (!summarize_errors) {
+		file_failure(status, path);
+		return;
+	}
+
+	switch (status) {
 	case ACCESS_FAILURE:
-		error(status, _("%s: cannot access '%s'"), PROGRAM_NAME, name);
+		error_record(errno, _("cannot access"), dirname, path);
 		break;
 	case OPENDIRECTRY_FAILURE:
-		error(status, _("%s: cannot open directory '%s'"), PROGRAM_NAME, name);
+		error_record(errno, _("cannot open directory"), dirname, path);
 		break;
 	}
 }
 
+/**
+ * invalid_argument - report invalid argument of option, and exit.
+ * @arg:    Option argument
+ * @option: Long option name
+ */
+static void invalid_argument(char const *arg, char const *option)
+{
+	fprintf(stderr, _("%s: invalid argument '%s' for '--%s'\n"),
+					PROGRAM_NAME, arg, option);
+	usage(CMDLINE_FAILURE);
+}
+
 /**
  * version - print out program version.
  * @command_name: command name
@@ -139,18 +303,139 @@ static enum
 	PRINT_ACCESS_TIME
 } print_time;
 
-/* File information slots */
-static struct fileinfo *files;
-static struct fileinfo **sorted;
-/* allocate `fileinfo` count in slots, index of first unused */
-static size_t alloc_count;
-static size_t unused_index;
-/* the number of columns to use for columns */
-static int nlink_width;
-static int user_width;
-static int group_width;
-static int file_size_width;
-static int time_width;
+/* "--color" option. colorize file names by LS_COLORS */
+static bool print_with_color;
+
+/* "--quoting-style" option. how file names are quoted */
+static enum quoting_style quoting_style;
+/* "-q" option. show unprintable characters as '?' */
+static bool hide_control;
+
+/* "-v" option. sort numbers in file names by value */
+static bool version_sort;
+
+/* "-Z" option. print security context of files */
+static bool print_context;
+/* "--xattr" option. probe ACL and security context of files (or '-Z') */
+static bool probe_xattr;
+
+/* "--type", "--newer-than", ... options. predicates on entries */
+static struct filter filter;
+static bool filtering;
+
+/* "-I" option. Files matching these patterns are never listed */
+static struct pattern_set *ignore_patterns;
+/* "--hide" option. Ignored as well, unless '-a' or '-A' is specified */
+static struct pattern_set *hide_patterns;
+
+/**
+ * struct fileslots - File information slots of one listing.
+ * @files:        File information
+ * @sorted:       sorted pointers to `files`
+ * @alloc_count:  allocate `fileinfo` count in slots
+ * @unused_index: index of first unused
+ * @memory:       bytes used by the entries now in slots
+ * @limit:        bytes of entries kept before spilling, 0 means unlimited
+ * @nospill:      temporary file cannot be used, keep entries in memory
+ * @heaped:       `sorted` is a heap of the selected entries ("--head")
+ * @runs:         sorted runs spilled from slots
+ * @nruns:        count of `runs`
+ * @nlink_width:  the number of columns to use for link count
+ * @user_width:   the number of columns to use for user
+ * @group_width:  the number of columns to use for group
+ * @file_size_width: the number of columns to use for file size
+ * @time_width:   the number of columns to use for time
+ * @xattr_width:  the number of columns to use for ACL indicator (0 or 1)
+ * @context_width: the number of columns to use for security context
+ */
+struct fileslots {
+	struct fileinfo *files;
+	struct fileinfo **sorted;
+	size_t alloc_count;
+	size_t unused_index;
+	size_t memory;
+	size_t limit;
+	bool nospill;
+	bool heaped;
+	FILE *runs[SPILL_MAX_RUNS];
+	size_t nruns;
+	int nlink_width;
+	int user_width;
+	int group_width;
+	int file_size_width;
+	int time_width;
+	int xattr_width;
+	int context_width;
+};
+
+/**
+ * struct listing - Directory listing prepared ahead of printing.
+ * @dirname: Base direcotry name
+ * @err:     errno of opening directory, 0 if opened
+ * @slots:   File information slots of directory contents
+ * @errors:  messages of reading directory, output when it is printed
+ */
+struct listing {
+	char *dirname;
+	int err;
+	struct fileslots slots;
+	struct error_log errors;
+};
+
+/* File information slots (used unless '--prefetch') */
+static struct fileslots slots;
+/* "--memory-limit" option. 0 means unlimited */
+static size_t memory_limit;
+/* "--head"/"--tail" option. print only first/last `select_count` files */
+static bool select_enabled;
+static bool select_tail;
+static size_t select_count;
+/* "--stat-timeout" option. deadline of metadata calls (ms), 0 means none */
+static size_t stat_timeout;
+/* "--dedupe" option. list each directory (st_dev, st_ino) only once */
+static bool dedupe_dirs;
+/* "--prefetch" option. count of directories read ahead, 0 means none */
+static size_t prefetch_count;
+/* "--save-snapshot" option. snapshot file to be written, NULL means none */
+static char const *save_snapshot;
+static struct snapshot *snapshot_out;
+/* "--diff-snapshot" option. snapshot file to be compared, NULL means none */
+static char const *diff_snapshot;
+static struct snapshot *snapshot_in;
+/* "--async-output" option. stdout is written by a writer thread */
+static bool async_output;
+/* stream of listing: stdout, or the stream of writer ('--async-output') */
+static FILE *output;
+/* "--checkpoint" option. checkpoint file, NULL means none */
+static char const *checkpoint_file;
+static struct timespec checkpoint_time;
+/* "--resume" option. list the directories pending in checkpoint */
+static bool resume_listing;
+/* position of listing (saved in checkpoint) */
+static struct checkpoint_pos position;
+/* directories taken from queue, and not yet printed (oldest first) */
+static char *inflight[PREFETCH_MAX + 1];
+static size_t ninflight;
+/* "--trace" option. trace file, NULL means none */
+static char const *trace_file;
+/* "--max-iops" option. metadata calls per second (0 means unlimited) */
+static size_t max_iops;
+static size_t max_burst;
+/* "--stats" option. report metadata calls and throttled time */
+static bool print_stats;
+/* "--daemon" option. socket to serve listings, NULL means none */
+static char const *daemon_socket;
+/* "--connect" option. socket of daemon listing for us, NULL means none */
+static char const *connect_socket;
+/* a request of '--daemon' is being served */
+static bool serving;
+/* "--daemon" option. directory entries are cached */
+static bool use_dircache;
+/* "--merge" option. list the entries of all directories as one listing */
+static bool merge_dirs;
+/* "--estimate" option. count of entries sampled, 0 means listing */
+static size_t estimate_count;
+static struct sample sample;
 /* time information */
 static struct timespec current;
 static struct timespec year_ago;
@@ -169,11 +454,218 @@ static struct option const longopts[] =
 {
 	{"all", no_argument, NULL, 'a'},
 	{"almost-all", no_argument, NULL, 'A'},
+	{"async-output", no_argument, NULL, GETOPT_ASYNC_OUTPUT_CHAR},
+	{"checkpoint", required_argument, NULL, GETOPT_CHECKPOINT_CHAR},
+	{"color", optional_argument, NULL, GETOPT_COLOR_CHAR},
+	{"connect", required_argument, NULL, GETOPT_CONNECT_CHAR},
+	{"context", no_argument, NULL, 'Z'},
+	{"daemon", required_argument, NULL, GETOPT_DAEMON_CHAR},
+	{"dedupe", no_argument, NULL, GETOPT_DEDUPE_CHAR},
+	{"error-summary", no_argument, NULL, GETOPT_ERROR_SUMMARY_CHAR},
+	{"escape", no_argument, NULL, 'b'},
+	{"estimate", optional_argument, NULL, GETOPT_ESTIMATE_CHAR},
+	{"diff-snapshot", required_argument, NULL, GETOPT_DIFF_SNAPSHOT_CHAR},
+	{"ignore", required_argument, NULL, 'I'},
+	{"hide", required_argument, NULL, GETOPT_HIDE_CHAR},
+	{"hide-control-chars", no_argument, NULL, 'q'},
+	{"max-iops", required_argument, NULL, GETOPT_MAX_IOPS_CHAR},
+	{"max-size", required_argument, NULL, GETOPT_MAX_SIZE_CHAR},
+	{"memory-limit", required_argument, NULL, GETOPT_MEMORY_LIMIT_CHAR},
+	{"merge", no_argument, NULL, GETOPT_MERGE_CHAR},
+	{"min-size", required_argument, NULL, GETOPT_MIN_SIZE_CHAR},
+	{"newer-than", required_argument, NULL, GETOPT_NEWER_THAN_CHAR},
+	{"older-than", required_argument, NULL, GETOPT_OLDER_THAN_CHAR},
+	{"prefetch", required_argument, NULL, GETOPT_PREFETCH_CHAR},
+	{"quoting-style", required_argument, NULL, GETOPT_QUOTING_STYLE_CHAR},
+	{"resume", no_argument, NULL, GETOPT_RESUME_CHAR},
+	{"save-snapshot", required_argument, NULL, GETOPT_SAVE_SNAPSHOT_CHAR},
+	{"head", required_argument, NULL, GETOPT_HEAD_CHAR},
+	{"show-control-chars", no_argument, NULL,
+					GETOPT_SHOW_CONTROL_CHARS_CHAR},
+	{"stat-timeout", required_argument, NULL, GETOPT_STAT_TIMEOUT_CHAR},
+	{"stats", no_argument, NULL, GETOPT_STATS_CHAR},
+	{"tail", required_argument, NULL, GETOPT_TAIL_CHAR},
+	{"trace", required_argument, NULL, GETOPT_TRACE_CHAR},
+	{"type", required_argument, NULL, GETOPT_TYPE_CHAR},
+	{"xattr", no_argument, NULL, GETOPT_XATTR_CHAR},
 	{"help",no_argument, NULL, GETOPT_HELP_CHAR},
 	{"version",no_argument, NULL, GETOPT_VERSION_CHAR},
 	{0,0,0,0}
 };
 
+/**
+ * parse_size - convert SIZE argument ("1024", "64K", "2M", "1G", ...)
+ * @arg:  Option argument
+ * @size: Output. Bytes (suffixes are powers of 1024)
+ *
+ * Return: true  - `arg` is valid SIZE
+ *         false - `arg` is invalid
+ */
+static bool parse_size(char const *arg, size_t *size)
+{
+	static const char suffixes[] = "KMGTPE";
+	unsigned long long value;
+	const char *unit;
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+		return false;
+	value = strtoull(arg, &end, 10);
+	if (*end) {
+		unit = strchr(suffixes, *end);
+		if (!unit || end[1] != '\0')
+			return false;
+		for (; unit >= suffixes; unit--) {
+			if (value > SIZE_MAX / 1024)
+				return false;
+			value *= 1024;
+		}
+	}
+	if (value > SIZE_MAX)
+		return false;
+
+	*size = value;
+	return true;
+}
+
+/**
+ * parse_count - convert non-negative decimal argument
+ * @arg:   Option argument
+ * @count: Output. value
+ *
+ * Return: true  - `arg` is valid number
+ *         false - `arg` is invalid
+ */
+static bool parse_count(char const *arg, size_t *count)
+{
+	unsigned long long value;
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+		return false;
+	errno = 0;
+	value = strtoull(arg, &end, 10);
+	if (*end || errno || value > SIZE_MAX)
+		return false;
+
+	*count = value;
+	return true;
+}
+
+/**
+ * parse_iops - convert IOPS argument ("500", "500,50")
+ * @arg:   Option argument (rate, optionally followed by ",BURST")
+ * @rate:  Output. calls per second (not 0)
+ * @burst: Output. calls made at once (1 if BURST is omitted)
+ *
+ * Return: true  - `arg` is valid IOPS
+ *         false - `arg` is invalid
+ */
+static bool parse_iops(char const *arg, size_t *rate, size_t *burst)
+{
+	char buf[64];
+	char *comma;
+
+	if (strlen(arg) >= sizeof(buf))
+		return false;
+	strcpy(buf, arg);
+	comma = strchr(buf, ',');
+	if (comma)
+		*comma = '\0';
+
+	if (!parse_count(buf, rate) || !*rate)
+		return false;
+	*burst = 1;
+	if (comma && (!parse_count(comma + 1, burst) || !*burst))
+		return false;
+	return true;
+}
+
+/**
+ * parse_age - convert AGE argument ("90", "30m", "12h", "7d", "2w")
+ * @arg:  Option argument (seconds without suffix)
+ * @when: Output. the time AGE ago
+ *
+ * Return: true  - `arg` is valid AGE
+ *         false - `arg` is invalid
+ */
+static bool parse_age(char const *arg, struct timespec *when)
+{
+	static const struct {
+		char suffix;
+		unsigned long seconds;
+	} units[] = {
+		{'s', 1}, {'m', 60}, {'h', 60 * 60}, {'d', 24 * 60 * 60},
+		{'w', 7 * 24 * 60 * 60}, {'\0', 1}
+	};
+	unsigned long long value;
+	size_t i;
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+		return false;
+	errno = 0;
+	value = strtoull(arg, &end, 10);
+	for (i = 0; units[i].suffix != *end; i++)
+		if (!units[i].suffix)
+			return false;
+	if (errno || (*end && end[1] != '\0') ||
+				value > INT32_MAX / units[i].seconds)
+		return false;
+
+	clock_gettime(CLOCK_REALTIME, when);
+	when->tv_sec -= value * units[i].seconds;
+	return true;
+}
+
+/**
+ * parse_color - convert WHEN argument of '--color'
+ * @arg:  Option argument (NULL means "always")
+ * @when: Output. colorize or not
+ *
+ * Return: true  - `arg` is valid WHEN
+ *         false - `arg` is invalid
+ */
+static bool parse_color(char const *arg, bool *when)
+{
+	if (!arg || !strcmp(arg, "always") || !strcmp(arg, "yes") ||
+						!strcmp(arg, "force"))
+		*when = true;
+	else if (!strcmp(arg, "never") || !strcmp(arg, "no") ||
+						!strcmp(arg, "none"))
+		*when = false;
+	else if (!strcmp(arg, "auto") || !strcmp(arg, "tty") ||
+						!strcmp(arg, "if-tty"))
+		*when = isatty(STDOUT_FILENO);
+	else
+		return false;
+	return true;
+}
+
+/* short options of decode_cmdline() */
+static const char shortopts[] = "alAbI:qvZ";
+
+/**
+ * report_option - Report invalid option in the language of user
+ * @argc: count of arguments
+ * @argv: arguments
+ *
+ * Messages of getopt_long() are suppressed while decoding, since the
+ * message catalogs are not loaded yet. Once they are loaded, the
+ * arguments are decoded again until the invalid option is reported.
+ */
+static void report_option(int argc, char **argv)
+{
+	int opt;
+
+	init_messages();
+	opterr = 1;
+	optind = 0;
+	do {
+		opt = getopt_long(argc, argv, shortopts, longopts, NULL);
+	} while (opt != -1 && opt != '?');
+}
+
 /**
  * decode_cmdline - analyze command-line arguments.
  * @argc: command-line argument count
@@ -189,8 +681,51 @@ static int decode_cmdline(int argc, char **argv)
 	int longindex = 0;
 	int opt = 0;
 
+	/* '--daemon' keeps the sets of its own command line until here */
+	clean_patterns(ignore_patterns);
+	clean_patterns(hide_patterns);
+	ignore_patterns = init_patterns();
+	hide_patterns = init_patterns();
+	if (!ignore_patterns || !hide_patterns) {
+		file_failure(ALLOCATION_FAILURE, NULL);
+		leave(ALLOCATION_FAILURE);
+	}
+
+	/* '--daemon' decodes the command line of each request */
+	print_with_color = false;
+	print_context = false;
+	probe_xattr = false;
+	version_sort = false;
+	quoting_style = QUOTE_LITERAL;
+	/* like ls, unprintable characters are hidden from terminal */
+	hide_control = isatty(STDOUT_FILENO);
+	memory_limit = 0;
+	init_filter(&filter);
+	select_enabled = false;
+	select_tail = false;
+	select_count = 0;
+	stat_timeout = 0;
+	dedupe_dirs = false;
+	prefetch_count = 0;
+	save_snapshot = NULL;
+	diff_snapshot = NULL;
+	async_output = false;
+	checkpoint_file = NULL;
+	resume_listing = false;
+	estimate_count = 0;
+	merge_dirs = false;
+	summarize_errors = false;
+	daemon_socket = NULL;
+	connect_socket = NULL;
+	trace_file = NULL;
+	max_iops = 0;
+	max_burst = 0;
+	print_stats = false;
+	optind = 0;
+	opterr = 0;
+
 	while ((opt = getopt_long(argc, argv,
-		"alA",
+		shortopts,
 		longopts, &longindex)) != -1) {
 		switch (opt) {
 		case 'a':
@@ -202,18 +737,191 @@ static int decode_cmdline(int argc, char **argv)
 		case 'A':
 			print_mode = PRINT_ALMOST;
 			break;
+		case 'b':
+			quoting_style = QUOTE_ESCAPE;
+			break;
+		case 'q':
+			hide_control = true;
+			break;
+		case 'v':
+			version_sort = true;
+			break;
+		case 'Z':
+			print_context = true;
+			break;
+		case GETOPT_XATTR_CHAR:
+			probe_xattr = true;
+			break;
+		case GETOPT_SHOW_CONTROL_CHARS_CHAR:
+			hide_control = false;
+			break;
+		case GETOPT_QUOTING_STYLE_CHAR: {
+			int style = quoting_style_of(optarg);
+
+			if (style < 0)
+				invalid_argument(optarg, "quoting-style");
+			quoting_style = style;
+			break;
+		}
+		case 'I':
+			if (add_pattern(ignore_patterns, optarg)) {
+				file_failure(ALLOCATION_FAILURE, NULL);
+				leave(ALLOCATION_FAILURE);
+			}
+			break;
+		case GETOPT_HIDE_CHAR:
+			if (add_pattern(hide_patterns, optarg)) {
+				file_failure(ALLOCATION_FAILURE, NULL);
+				leave(ALLOCATION_FAILURE);
+			}
+			break;
+		case GETOPT_MEMORY_LIMIT_CHAR:
+			if (!parse_size(optarg, &memory_limit))
+				invalid_argument(optarg, "memory-limit");
+			break;
+		case GETOPT_TYPE_CHAR:
+			if (filter_add_types(&filter, optarg))
+				invalid_argument(optarg, "type");
+			break;
+		case GETOPT_NEWER_THAN_CHAR:
+			if (!parse_age(optarg, &filter.newer))
+				invalid_argument(optarg, "newer-than");
+			filter.has_newer = true;
+			break;
+		case GETOPT_OLDER_THAN_CHAR:
+			if (!parse_age(optarg, &filter.older))
+				invalid_argument(optarg, "older-than");
+			filter.has_older = true;
+			break;
+		case GETOPT_MIN_SIZE_CHAR:
+		case GETOPT_MAX_SIZE_CHAR: {
+			size_t size;
+
+			if (!parse_size(optarg, &size))
+				invalid_argument(optarg, opt == GETOPT_MIN_SIZE_CHAR ?
+							"min-size" : "max-size");
+			if (opt == GETOPT_MIN_SIZE_CHAR)
+				filter.min_size = size;
+			else
+				filter.max_size = size;
+			break;
+		}
+		case GETOPT_PREFETCH_CHAR:
+			if (!parse_count(optarg, &prefetch_count) ||
+				prefetch_count > PREFETCH_MAX)
+				invalid_argument(optarg, "prefetch");
+			break;
+		case GETOPT_STAT_TIMEOUT_CHAR:
+			if (!parse_count(optarg, &stat_timeout))
+				invalid_argument(optarg, "stat-timeout");
+			break;
+		case GETOPT_MAX_IOPS_CHAR:
+			if (!parse_iops(optarg, &max_iops, &max_burst))
+				invalid_argument(optarg, "max-iops");
+			break;
+		case GETOPT_STATS_CHAR:
+			print_stats = true;
+			break;
+		case GETOPT_DEDUPE_CHAR:
+			dedupe_dirs = true;
+			break;
+		case GETOPT_MERGE_CHAR:
+			merge_dirs = true;
+			break;
+		case GETOPT_DAEMON_CHAR:
+			daemon_socket = optarg;
+			break;
+		case GETOPT_CONNECT_CHAR:
+			connect_socket = optarg;
+			break;
+		case GETOPT_TRACE_CHAR:
+			trace_file = optarg;
+			break;
+		case GETOPT_CHECKPOINT_CHAR:
+			checkpoint_file = optarg;
+			break;
+		case GETOPT_RESUME_CHAR:
+			resume_listing = true;
+			break;
+		case GETOPT_ASYNC_OUTPUT_CHAR:
+			async_output = true;
+			break;
+		case GETOPT_ERROR_SUMMARY_CHAR:
+			summarize_errors = true;
+			break;
+		case GETOPT_ESTIMATE_CHAR:
+			estimate_count = ESTIMATE_SAMPLE;
+			if (optarg && (!parse_count(optarg, &estimate_count) ||
+							!estimate_count))
+				invalid_argument(optarg, "estimate");
+			break;
+		case GETOPT_SAVE_SNAPSHOT_CHAR:
+			save_snapshot = optarg;
+			break;
+		case GETOPT_DIFF_SNAPSHOT_CHAR:
+			diff_snapshot = optarg;
+			break;
+		case GETOPT_COLOR_CHAR:
+			if (!parse_color(optarg, &print_with_color))
+				invalid_argument(optarg, "color");
+			break;
+		case GETOPT_HEAD_CHAR:
+		case GETOPT_TAIL_CHAR:
+			select_enabled = true;
+			select_tail = (opt == GETOPT_TAIL_CHAR);
+			if (!parse_count(optarg, &select_count))
+				invalid_argument(optarg,
+					select_tail ? "tail" : "head");
+			break;
 		case GETOPT_HELP_CHAR:
 			usage(EXIT_SUCCESS);
 			break;
 		case GETOPT_VERSION_CHAR:
 			version(PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_AUTHOR);
-			exit(EXIT_SUCCESS);
+			leave(EXIT_SUCCESS);
 			break;
 		default:
+			report_option(argc, argv);
+			usage(CMDLINE_FAILURE);
+		}
+	}
+
+	if (resume_listing && !checkpoint_file) {
+		fprintf(stderr, _("%s: '--resume' requires '--checkpoint'\n"),
+							PROGRAM_NAME);
+		usage(CMDLINE_FAILURE);
+	}
+
+	/*
+	 * merged listing prints no directory before all are read, and its
+	 * entries are not listed by directory (snapshot, '--head', '--tail')
+	 */
+	if (merge_dirs) {
+		char const *conflict = NULL;
+
+		if (checkpoint_file)
+			conflict = "checkpoint";
+		else if (save_snapshot)
+			conflict = "save-snapshot";
+		else if (diff_snapshot)
+			conflict = "diff-snapshot";
+		else if (select_enabled)
+			conflict = select_tail ? "tail" : "head";
+		if (conflict) {
+			fprintf(stderr,
+				_("%s: '--merge' cannot be used with '--%s'\n"),
+						PROGRAM_NAME, conflict);
 			usage(CMDLINE_FAILURE);
 		}
 	}
 
+	/* merged listing needs all the entries in slots */
+	if (merge_dirs)
+		memory_limit = 0;
+	filtering = filter_enabled(&filter);
+	if (print_context)
+		probe_xattr = true;
+
 	return optind;
 }
 
@@ -237,23 +945,6 @@ static void joinpath(char *dest, const char *dirname, const char *name)
 	*dest = '\0';
 }
 
-/**
- * dot_or_ddot - Check whether File name is "." OR ".."
- * @name:   File name
- *
- * Return: true  - File name is "." OR ".."
- *         false - File name is Regular file
- */
-static inline bool dot_or_ddot(char const *name)
-{
-	bool ret = false;
-	if (name != NULL && name[0] == '.') {
-		char sep = name[(name[1] == '.') + 1];
-		ret = (!sep || sep == '/');
-	}
-	return ret;
-}
-
 /**
  * COMPARE RESULT compare(a, b);
  *  -1: *a is earlier than *b
@@ -264,6 +955,40 @@ enum
 	COMPARE_EARLIER = -1,
 	COMPARE_LATER = 1
 };
+/**
+ * compare_version - Compare filename in version order ('-v')
+ * @a:   fileinfo
+ * @b:   fileinfo
+ *
+ * Sort keys are encoded when the files enter slots. Only the entries of
+ * snapshot ('--diff-snapshot') have no key, and it is encoded here.
+ * Names of the same key (e.g. "a01" and "a1") are ordered by strcmp().
+ *
+ * Return:  negative - earlier than
+ *          positive - later than
+ *          0 - equal to
+ */
+static int compare_version(const struct fileinfo *a, const struct fileinfo *b)
+{
+	const char *akey = a->key;
+	const char *bkey = b->key;
+	char *buf;
+	int ret;
+
+	if (!akey) {
+		buf = alloca(version_key(NULL, a->name) + 1);
+		version_key(buf, a->name);
+		akey = buf;
+	}
+	if (!bkey) {
+		buf = alloca(version_key(NULL, b->name) + 1);
+		version_key(buf, b->name);
+		bkey = buf;
+	}
+	ret = strcmp(akey, bkey);
+	return ret ? ret : strcmp(a->name, b->name);
+}
+
 /**
  * compare_name - Compare filename (Dirname > Filename)
  * @a:   fileinfo pointer
@@ -284,40 +1009,124 @@ static int compare_name(const void *a, const void *b)
 	if (!S_ISDIR(ai->status.st_mode) && S_ISDIR(bi->status.st_mode))
 		return COMPARE_LATER;
 
+	if (version_sort)
+		return compare_version(ai, bi);
 	return strcmp(ai->name, bi->name);
 }
 
+/**
+ * snapshot_sort - Sort order of compare_name(), recorded in snapshot
+ *
+ * Return: SNAPSHOT_SORT_* flags
+ */
+static unsigned int snapshot_sort(void)
+{
+	return SNAPSHOT_SORT_DIRS_FIRST |
+			(version_sort ? SNAPSHOT_SORT_VERSION : 0);
+}
+
+/**
+ * dot_entry - Check whether directory entry is "." OR ".." (branchless)
+ * @name:   File name of directory entry (not empty, no '/')
+ *
+ * name[1] exists since name is not empty, and name[2] is read only
+ * if name[1] is '.'.
+ *
+ * Return: true  - File name is "." OR ".."
+ *         false - otherwise
+ */
+static inline bool dot_entry(char const *name)
+{
+	unsigned int dot = (name[0] == '.');
+	unsigned int ddot = dot & (name[1] == '.');
+
+	return dot & !name[1 + ddot];
+}
+
+/**
+ * DEFINE_IGNORED - Define a variant of file_ignored()
+ * @func: function name
+ * @expr: true if `name` should be ignored
+ *
+ * Called before the entry is stat'ed, so that ignored files cost
+ * neither a system call nor an allocation.
+ */
+#define DEFINE_IGNORED(func, expr)					\
+static bool func(char const *name)					\
+{									\
+	return (expr);							\
+}
+
+/* Default. Ignore ".FILENAME" (and "." "..") */
+DEFINE_IGNORED(ignored_default, name[0] == '.')
+DEFINE_IGNORED(ignored_default_patterns, name[0] == '.' ||
+		match_patterns(hide_patterns, name) ||
+		match_patterns(ignore_patterns, name))
+/* "-A" option. Ignore "." AND ".." */
+DEFINE_IGNORED(ignored_almost, dot_entry(name))
+DEFINE_IGNORED(ignored_almost_patterns, dot_entry(name) ||
+		match_patterns(ignore_patterns, name))
+/* "-a" option. Ignore only '-I' patterns */
+DEFINE_IGNORED(ignored_all, false)
+DEFINE_IGNORED(ignored_all_patterns, match_patterns(ignore_patterns, name))
+
+/* variants of file_ignored() by [print_mode][patterns are given] */
+static bool (*const ignorers[][2])(char const *) =
+{
+	[PRINT_DEFAULT] = {ignored_default, ignored_default_patterns},
+	[PRINT_ALMOST] = {ignored_almost, ignored_almost_patterns},
+	[PRINT_ALL] = {ignored_all, ignored_all_patterns}
+};
+
 /**
  * file_ignored - "." or ".." is normally ignored.
  * @name:   File name
  *
- * Return: true  - File should be ignore ("." OR ".." OR ".FILENAME")
+ * Resolved by resolve_modes().
+ *
+ * Return: true  - File should be ignore ("." OR ".." OR ".FILENAME"
+ *                 OR matches '-I' OR matches '--hide' without '-a'/'-A')
  *         false - File shoule be print  ("FILENAME" OR '-a' option)
  */
-static bool file_ignored(char const *name)
-{
-	bool ret = false;
+static bool (*file_ignored)(char const *name) = ignored_default;
 
-	switch (print_mode) {
-	case PRINT_DEFAULT:
-		ret = (name[0] == '.') ? true : false;
-	case PRINT_ALMOST:
-		ret |= dot_or_ddot(name);
-	case PRINT_ALL:
-		break;
+/**
+ * init_slots - Initialize File information slots
+ * @s: File information slots
+ *
+ * File information slots initialize.(allocation count, index,...)
+ * If Failure allocation, slots are left empty (and may be cleaned).
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int init_slots(struct fileslots *s)
+{
+	memset(s, '\0', sizeof(*s));
+	s->alloc_count = ALLOCATE_COUNT;
+	s->limit = memory_limit;
+
+	s->files = malloc(s->alloc_count * (sizeof(*s->files)));
+	s->sorted = malloc(s->alloc_count * (sizeof(*s->sorted)));
+	if (!s->files || !s->sorted) {
+		free(s->sorted);
+		free(s->files);
+		memset(s, '\0', sizeof(*s));
+		return ALLOCATION_FAILURE;
 	}
-	return ret;
+	return 0;
 }
 
 /**
- * init_slots - Initialize File information slots
+ * slot_cost - Bytes used in slots by a File information
+ * @name:    File name
  *
- * File information slots initialize.(allocation count, index,...)
+ * Return: bytes of `files` and `sorted` element, and file name
  */
-static void init_slots(void)
+static inline size_t slot_cost(char const *name)
 {
-	alloc_count = 0;
-	unused_index = 0;
+	return sizeof(struct fileinfo) + sizeof(struct fileinfo *) +
+							strlen(name) + 1;
 }
 
 /**
@@ -328,9 +1137,9 @@ static void init_slots(void)
  */
 static void set_useralign(uid_t uid, char *u_buf, int width)
 {
-	struct passwd *passwd = getpwuid(uid);
-	if (passwd)
-		sprintf(u_buf, "%-*s", width, passwd->pw_name);
+	const char *user = getuser(uid);
+	if (user)
+		sprintf(u_buf, "%-*s", width, user);
 	else
 		sprintf(u_buf, "%-*d", width, uid);
 }
@@ -343,15 +1152,115 @@ static void set_useralign(uid_t uid, char *u_buf, int width)
  */
 static void set_groupalign(gid_t gid, char *g_buf, int width)
 {
-	struct group *group = getgrgid(gid);
+	const char *group = getgroup(gid);
 	if (group)
-		sprintf(g_buf, "%-*s", width, group->gr_name);
+		sprintf(g_buf, "%-*s", width, group);
 	else
 		sprintf(g_buf, "%-*d", width, gid);
 }
 
+/**
+ * stat_entry - get File status, paced by '--max-iops' and bounded by
+ *              '--stat-timeout'
+ * @dirfd:  Base direcotry file descriptor (or AT_FDCWD)
+ * @name:   File name, relative to `dirfd`
+ * @status: Output. File status (not following symbolic link)
+ *
+ * Return: 0 - success
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+static int stat_entry(int dirfd, char const *name, struct stat *status)
+{
+	ratelimit_take(1);
+	if (stat_timeout)
+		return timed_fstatat(dirfd, name, status, AT_SYMLINK_NOFOLLOW);
+	return fstatat(dirfd, name, status, AT_SYMLINK_NOFOLLOW);
+}
+
+/**
+ * readlink_entry - read symbolic link target, paced by '--max-iops' and
+ *                  bounded by '--stat-timeout'
+ * @dirfd: Base direcotry file descriptor (or AT_FDCWD)
+ * @name:  File name, relative to `dirfd`
+ * @buf:   Output. Symbolic link target (not terminated by '\0')
+ * @size:  size of `buf`
+ *
+ * Return: length of target
+ *         -1 - error
+ */
+static ssize_t readlink_entry(int dirfd, char const *name, char *buf,
+								size_t size)
+{
+	ratelimit_take(1);
+	if (stat_timeout)
+		return timed_readlinkat(dirfd, name, buf, size);
+	return readlinkat(dirfd, name, buf, size);
+}
+
+/**
+ * set_filename - Store file name (and symbolic link target) in File information
+ * @f:       File information (status is already set)
+ * @dirfd:   Base direcotry file descriptor (or AT_FDCWD)
+ * @name:    File name, relative to `dirfd`
+ * @context: Security context, NULL if none
+ *
+ * In long format, the target of symbolic link is read by readlinkat(),
+ * and stored just after the name in the same allocation, followed by
+ * the security context and the sort key ('-v').
+ * If the target cannot be read, `linkname` is left NULL.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int set_filename(struct fileinfo *f, int dirfd, char const *name,
+							char const *context)
+{
+	size_t namelen = strlen(name);
+	size_t contextlen = context ? strlen(context) + 1 : 0;
+	size_t keylen = version_sort ? version_key(NULL, name) + 1 : 0;
+	size_t size = 0;
+	ssize_t len;
+	bool link = print_format == PRINT_LONG_FORMAT &&
+					S_ISLNK(f->status.st_mode);
+
+	if (link)
+		size = f->status.st_size > 0 ? f->status.st_size + 1 : PATH_MAX;
+
+	for (;;) {
+		f->name = malloc((namelen + 1 + size + contextlen + keylen) *
+							sizeof(*name));
+		if (!f->name)
+			return ALLOCATION_FAILURE;
+		memcpy(f->name, name, namelen + 1);
+		if (context) {
+			f->context = f->name + namelen + 1 + size;
+			memcpy(f->context, context, contextlen);
+		}
+		if (version_sort) {
+			f->key = f->name + namelen + 1 + size + contextlen;
+			version_key(f->key, name);
+		}
+		if (!link)
+			return 0;
+
+		len = readlink_entry(dirfd, name, f->name + namelen + 1, size);
+		if (len < 0)
+			return 0;
+		if (len < size) {
+			f->linkname = f->name + namelen + 1;
+			f->linkname[len] = '\0';
+			return 0;
+		}
+		/* target has grown since lstat, try again */
+		free(f->name);
+		size *= 2;
+	}
+}
+
 /**
  * addfiles_slots - Add a File information to slots
+ * @s:       File information slots
+ * @dirfd:   Base direcotry file descriptor (or AT_FDCWD)
  * @name:    File name
  * @dirname: Base direcotry name
  * @command_line_arg: Command line argument
@@ -359,52 +1268,85 @@ static void set_groupalign(gid_t gid, char *g_buf, int width)
  * Return: 0 - success
  *         otherwise - error(show ERROR STATUS CODE)
  */
-static int addfiles_slots(char const *name, char const *dirname,
-						bool command_arg)
+static int addfiles_slots(struct fileslots *s, int dirfd, char const *name,
+			char const *dirname, bool command_arg)
 {
 	int err = 0;
 	struct fileinfo *finfo;
-
-	if (alloc_count <= unused_index) {
-		alloc_count += ALLOCATE_COUNT;
-		files = realloc(files, alloc_count);
-		if (!files) {
-			file_failure(ALLOCATION_FAILURE, NULL);
-			free(files);
-			exit(ALLOCATION_FAILURE);
-		}
-		sorted = realloc(sorted, alloc_count);
-		if (!sorted) {
+	char *context = NULL;
+
+	if (s->alloc_count <= s->unused_index) {
+		size_t alloc_count = s->alloc_count + ALLOCATE_COUNT;
+		struct fileinfo *files;
+		struct fileinfo **sorted;
+
+		/* like a failure on the name, the entry is not listed */
+		files = realloc(s->files, alloc_count * sizeof(*s->files));
+		if (files)
+			s->files = files;
+		sorted = realloc(s->sorted, alloc_count * sizeof(*s->sorted));
+		if (sorted)
+			s->sorted = sorted;
+		if (!files || !sorted) {
 			file_failure(ALLOCATION_FAILURE, NULL);
-			free(sorted);
-			exit(ALLOCATION_FAILURE);
+			return ALLOCATION_FAILURE;
 		}
+		s->alloc_count = alloc_count;
 	}
-	finfo = &files[unused_index];
+	finfo = &s->files[s->unused_index];
 	memset(finfo, '\0', sizeof(*finfo));
 
-	char *path;
-	if (name[0] == '/' || dirname[0] == '\0') {
-		path = (char *)name;
-	} else {
-		path = alloca(strlen(name) + strlen(dirname) + 2);
-		joinpath(path, dirname, name);
+	err = stat_entry(dirfd, name, &finfo->status);
+	if (err) {
+		char *path;
+		bool timedout = (errno == ETIMEDOUT);
+		if (name[0] == '/' || dirname[0] == '\0') {
+			path = (char *)name;
+		} else {
+			path = alloca(strlen(name) + strlen(dirname) + 2);
+			joinpath(path, dirname, name);
+		}
+		entry_failure(ACCESS_FAILURE, dirname, path);
+		if (!timedout)
+			goto errout;
+		/* Still listed, with unknown status */
+		memset(&finfo->status, '\0', sizeof(finfo->status));
+		finfo->unknown = true;
+		err = 0;
 	}
 
-	err = lstat(path, &finfo->status);
-	if (err) {
-		file_failure(ACCESS_FAILURE, path);
+	/* dropped before the entry costs sorting and formatting */
+	if (filtering && !command_arg && !finfo->unknown &&
+				!filter_status(&filter, &finfo->status))
 		goto errout;
-	}
 
-	finfo->name = malloc((strlen(name) + 1) * sizeof(*name));
-	if (!finfo->name) {
+	if (probe_xattr && !finfo->unknown) {
+		/* tokens are taken by each system call of the probe */
+		finfo->xattr = xattr_probe(dirfd, dirname, name,
+				finfo->status.st_dev, print_context ? &context : NULL);
+	}
+	err = set_filename(finfo, dirfd, name, context);
+	free(context);
+	if (err) {
 		file_failure(ALLOCATION_FAILURE, NULL);
-		err = ALLOCATION_FAILURE;
 		goto errout;
 	}
-	strncpy(finfo->name, name, strlen(name) + 1);
 	finfo->is_command_arg = command_arg;
+	s->memory += slot_cost(name);
+	if (finfo->linkname)
+		s->memory += strlen(finfo->linkname) + 1;
+	if (finfo->context)
+		s->memory += strlen(finfo->context) + 1;
+	if (finfo->key)
+		s->memory += strlen(finfo->key) + 1;
+	if (finfo->xattr)
+		s->xattr_width = 1;
+	if (print_context) {
+		int width = finfo->context ? strlen(finfo->context) : 1;
+
+		if (s->context_width < width)
+			s->context_width = width;
+	}
 
 	if (print_format == PRINT_LONG_FORMAT) {
 		char buf[FILETYPE_SIZE +
@@ -417,29 +1359,29 @@ static int addfiles_slots(char const *name, char const *dirname,
 		uid_t uid = finfo->status.st_uid;
 		set_useralign(uid, buf, 0);
 		len = strlen(buf);
-		if (user_width < len)
-			user_width = len;
+		if (s->user_width < len)
+			s->user_width = len;
 
 		gid_t gid = finfo->status.st_gid;
 		set_groupalign(gid, buf, 0);
 		len = strlen(buf);
-		if (group_width < len)
-			group_width = len;
+		if (s->group_width < len)
+			s->group_width = len;
 
 		size_t size = finfo->status.st_size;
 		sprintf(buf, "%lu", size);
 		len = strlen(buf);
-		if (file_size_width < len)
-			file_size_width = len;
+		if (s->file_size_width < len)
+			s->file_size_width = len;
 
 		size_t nlink = finfo->status.st_nlink;
 		sprintf(buf, "%lu", nlink);
 		len = strlen(buf);
-		if (nlink_width < len)
-			nlink_width = len;
+		if (s->nlink_width < len)
+			s->nlink_width = len;
 	}
 
-	unused_index++;
+	s->unused_index++;
 errout:
 	return err;
 }
@@ -499,19 +1441,65 @@ static void get_filemode(mode_t mode, char *dest)
 }
 
 /**
- * __printfiles_slots - Print the file name
+ * print_name - Print the file name, surrounded by color if '--color'
  * @out:    Output streams
  * @f:      File information.
  *
- * Return:  Number of items write
+ * Return:  Number of items write (without escape sequences)
  */
-static size_t __printfiles_slots(FILE *out, const struct fileinfo *f)
+static size_t print_name(FILE *out, const struct fileinfo *f)
 {
-	size_t len = 0;
+	const struct color_seq *seq = NULL;
 	const char *name = f->name;
-
-	if (out != NULL)
-		len = fwrite(name, sizeof(char), strlen(name) + 1, out);
+	size_t len;
+
+	if (print_with_color)
+		seq = color_lookup(name, ftypelet(f->status.st_mode),
+							f->status.st_mode);
+	if (seq)
+		fwrite(seq->str, sizeof(char), seq->len, out);
+	len = quote_name(out, name);
+	if (seq) {
+		seq = color_end();
+		fwrite(seq->str, sizeof(char), seq->len, out);
+	}
+	return len;
+}
+
+/**
+ * print_context_column - Print the security context, and a space ('-Z')
+ * @out:    Output streams
+ * @s:      File information slots (for the column width)
+ * @f:      File information.
+ *
+ * Return:  Number of items write
+ */
+static size_t print_context_column(FILE *out, const struct fileslots *s,
+						const struct fileinfo *f)
+{
+	if (!print_context)
+		return 0;
+	return fprintf(out, "%-*s ", s->context_width,
+					f->context ? f->context : "?");
+}
+
+/**
+ * __printfiles_slots - Print the file name
+ * @out:    Output streams
+ * @s:      File information slots (for the column widths)
+ * @f:      File information.
+ *
+ * Return:  Number of items write
+ */
+static size_t __printfiles_slots(FILE *out, const struct fileslots *s,
+						const struct fileinfo *f)
+{
+	size_t len = 0;
+
+	if (out != NULL) {
+		len = print_context_column(out, s, f);
+		len += print_name(out, f);
+	}
 	return len;
 }
 
@@ -532,14 +1520,46 @@ timecmp (struct timespec a, struct timespec b)
 			: (int) (a.tv_nsec - b.tv_nsec));
 }
 
+/**
+ * __printfiles_slots_unknown - Print the file name with unknown status
+ * @out:    Output streams
+ * @s:      File information slots (for the column widths)
+ * @f:      File information. (status is not known)
+ *
+ * Used for the files whose status could not be read before
+ * '--stat-timeout'. Every field but name is shown as '?'.
+ *
+ * Return:  Number of items write
+ */
+static size_t __printfiles_slots_unknown(FILE *out,
+		const struct fileslots *s, const struct fileinfo *f)
+{
+	size_t len = 0;
+
+	if (out != NULL) {
+		len = fprintf(out, "??????????%s %*s %-*s %-*s ",
+				s->xattr_width ? "?" : "",
+				s->nlink_width, "?", s->user_width, "?",
+				s->group_width, "?");
+		len += print_context_column(out, s, f);
+		len += fprintf(out, "%*s %12s ", s->file_size_width, "?", "?");
+		len += print_name(out, f);
+	}
+	return len;
+}
+
 /**
  * __printfiles_slots_long - Print the file name in long format
  * @out:    Output streams
+ * @s:      File information slots (for the column widths)
  * @f:      File information.
+ * @ts:     time to be shown (modify, change or access time of `f`)
  *
  * Return:  Number of items write
  */
-static size_t __printfiles_slots_long(FILE *out, const struct fileinfo *f)
+static inline size_t __printfiles_slots_long(FILE *out,
+		const struct fileslots *s, const struct fileinfo *f,
+		struct timespec ts)
 {
 	char mode[FILETYPE_SIZE] = {0};
 	char n_links[FILELINK_SIZE] = {0};
@@ -547,222 +1567,1486 @@ static size_t __printfiles_slots_long(FILE *out, const struct fileinfo *f)
 	char group[FILEUSERGROUP_SIZE] = {0};
 	char size[FILESIZE_SIZE] = {0};
 	char time[FILETIME_SIZE];
-	struct timespec ts;
 	bool recent;
 	size_t len = 0;
-	const char *name = f->name;
 
-	get_filemode(f->status.st_mode, mode);
-	sprintf(n_links, "%*lu", nlink_width, f->status.st_nlink);
-	set_useralign(f->status.st_uid, user, user_width);
-	set_groupalign(f->status.st_gid, group, group_width);
-	sprintf(size, "%*lu", file_size_width, f->status.st_size);
+	if (f->unknown)
+		return __printfiles_slots_unknown(out, s, f);
 
-	switch (print_time)
-	{
-		case PRINT_MODIFY_TIME:
-			ts = f->status.st_mtim;
-			break;
-		case PRINT_CHANGE_TIME:
-			ts = f->status.st_ctim;
-			break;
-		case PRINT_ACCESS_TIME:
-			ts = f->status.st_atim;
-			break;
+	get_filemode(f->status.st_mode, mode);
+	if (s->xattr_width) {
+		mode[10] = f->xattr ? f->xattr : ' ';
+		mode[11] = '\0';
 	}
+	sprintf(n_links, "%*lu", s->nlink_width, f->status.st_nlink);
+	set_useralign(f->status.st_uid, user, s->user_width);
+	set_groupalign(f->status.st_gid, group, s->group_width);
+	sprintf(size, "%*lu", s->file_size_width, f->status.st_size);
+
 	recent = (timecmp(year_ago, ts) < 0);
 	strftime(time,
 			FILETIME_SIZE,
 			long_time_format[recent],
 			localtime(&ts.tv_sec));
 
-	if (out != NULL)
-		len = fprintf(out, "%s %s %s %s %s %s %s",
-				mode, n_links, user, group, size, time, name);
+	if (out != NULL) {
+		len = fprintf(out, "%s %s %s %s ", mode, n_links, user, group);
+		len += print_context_column(out, s, f);
+		len += fprintf(out, "%s %s ", size, time);
+		len += print_name(out, f);
+	}
+	if (out != NULL && f->linkname) {
+		len += fprintf(out, " -> ");
+		len += quote_name(out, f->linkname);
+	}
 	return len;
 }
 
+/**
+ * struct printer - Routines printing files, for a print format and time.
+ * @entry: print a file (without newline)
+ * @slots: list all the files in slots
+ */
+struct printer {
+	size_t (*entry)(FILE *, const struct fileslots *,
+					const struct fileinfo *);
+	void (*slots)(const struct fileslots *);
+};
+
+/**
+ * DEFINE_PRINTER - Define the routines of struct printer
+ * @name: prefix of routines
+ * @row:  expression printing `f` to `out` (with `s` for the widths)
+ *
+ * `row` is expanded into the loop of name##_slots(), so that the loop
+ * runs without testing print format and time for each file.
+ */
+#define DEFINE_PRINTER(name, row)					\
+static size_t name##_entry(FILE *out, const struct fileslots *s,	\
+					const struct fileinfo *f)	\
+{									\
+	return (row);							\
+}									\
+static void name##_slots(const struct fileslots *s)			\
+{									\
+	size_t i;							\
+									\
+	for (i = 0; i < s->unused_index; i++) {			\
+		name##_entry(output, s, s->sorted[i]);			\
+		putc('\n', output);					\
+	}								\
+}
+
+DEFINE_PRINTER(print_default, __printfiles_slots(out, s, f))
+DEFINE_PRINTER(print_long_mtime,
+		__printfiles_slots_long(out, s, f, f->status.st_mtim))
+DEFINE_PRINTER(print_long_ctime,
+		__printfiles_slots_long(out, s, f, f->status.st_ctim))
+DEFINE_PRINTER(print_long_atime,
+		__printfiles_slots_long(out, s, f, f->status.st_atim))
+
+/* printers by [print_format][print_time] */
+static const struct printer printers[][3] =
+{
+	[PRINT_DEFAULT_FORMAT] = {
+		[PRINT_MODIFY_TIME] = {print_default_entry, print_default_slots},
+		[PRINT_CHANGE_TIME] = {print_default_entry, print_default_slots},
+		[PRINT_ACCESS_TIME] = {print_default_entry, print_default_slots}
+	},
+	[PRINT_LONG_FORMAT] = {
+		[PRINT_MODIFY_TIME] = {print_long_mtime_entry, print_long_mtime_slots},
+		[PRINT_CHANGE_TIME] = {print_long_ctime_entry, print_long_ctime_slots},
+		[PRINT_ACCESS_TIME] = {print_long_atime_entry, print_long_atime_slots}
+	}
+};
+
+/* printer of print format and time, resolved by resolve_modes() */
+static const struct printer *printer = &printers[0][0];
+
 /**
  * printfiles_slots - List all the files in slots
+ * @s: File information slots
  */
-static void printfiles_slots(void)
+static inline void printfiles_slots(const struct fileslots *s)
 {
-	int i;
+	printer->slots(s);
+}
 
-	switch (print_format) {
-	case PRINT_DEFAULT_FORMAT:
-		for (i = 0; i < unused_index; i++) {
-			__printfiles_slots(stdout, sorted[i]);
-			putchar('\n');
-		}
-		break;
-	case PRINT_LONG_FORMAT:
-		for (i = 0; i < unused_index; i++) {
-			__printfiles_slots_long(stdout, sorted[i]);
-			putchar('\n');
+/**
+ * printfile - Print a file (`emit` callback of spill_merge())
+ * @f:   File information
+ * @arg: File information slots which `f` belongs to
+ *
+ * Return: 0 (always continue)
+ */
+static int printfile(const struct fileinfo *f, void *arg)
+{
+	printer->entry(output, arg, f);
+	putc('\n', output);
+	return 0;
+}
+
+/**
+ * resolve_modes - Select the routines for print mode, format and time
+ *
+ * Called once after decode_cmdline(), so that the loops over entries
+ * run without testing the modes for each entry.
+ */
+static void resolve_modes(void)
+{
+	bool patterns = !empty_patterns(ignore_patterns) ||
+		(print_mode == PRINT_DEFAULT && !empty_patterns(hide_patterns));
+
+	file_ignored = ignorers[print_mode][patterns];
+	printer = &printers[print_format][print_time];
+}
+
+/**
+ * struct listcursor - State of listing through listfile().
+ * @slots:   File information slots which the entries belong to
+ * @old:     entry of snapshot not yet merged ('--diff-snapshot')
+ * @has_old: `old` is valid
+ */
+struct listcursor {
+	struct fileslots *slots;
+	struct fileinfo old;
+	bool has_old;
+};
+
+/**
+ * next_old - Read next entry of snapshot into cursor
+ * @c: listing cursor
+ */
+static void next_old(struct listcursor *c)
+{
+	int ret;
+
+	free(c->old.name);
+	c->old.name = NULL;
+	ret = snapshot_read(snapshot_in, &c->old);
+	if (ret > 0)
+		file_failure(SNAPSHOT_FAILURE, diff_snapshot);
+	c->has_old = !ret;
+}
+
+/**
+ * printdiff - Print a file with the mark of difference
+ * @mark: '+' (added), '-' (removed) or '~' (changed)
+ * @f:    File information
+ * @s:    File information slots (for the column widths)
+ */
+static void printdiff(char mark, const struct fileinfo *f,
+						struct fileslots *s)
+{
+	putc(mark, output);
+	putc(' ', output);
+	printfile(f, s);
+}
+
+/**
+ * difffile - Merge a file of listing with snapshot ('--diff-snapshot')
+ * @c: listing cursor
+ * @f: File information (in sorted order)
+ *
+ * Both the snapshot and the listing are sorted by compare_name() (the
+ * snapshot of another sort order is rejected by snapshot_open()), so
+ * that the entries of snapshot before `f` are the removed ones, and
+ * the entry equal to `f` (if any) is the one to be compared.
+ */
+static void difffile(struct listcursor *c, const struct fileinfo *f)
+{
+	const struct fileinfo *old = &c->old;
+
+	while (c->has_old) {
+		int cmp = compare_name(&old, &f);
+
+		if (cmp > 0)
+			break;
+		if (!cmp) {
+			if (snapshot_changed(old, f))
+				printdiff('~', f, c->slots);
+			next_old(c);
+			return;
 		}
-		break;
+		printdiff('-', old, c->slots);
+		next_old(c);
 	}
+	printdiff('+', f, c->slots);
 }
 
 /**
- * clear_slots - clean up file information slots
+ * listfile - List a file (`emit` callback of spill_merge())
+ * @f:   File information
+ * @arg: listing cursor
  *
+ * The file is saved to snapshot ('--save-snapshot'), and printed, or
+ * compared with snapshot ('--diff-snapshot').
+ *
+ * Return: 0 (always continue)
+ */
+static int listfile(const struct fileinfo *f, void *arg)
+{
+	struct listcursor *c = arg;
+
+	if (snapshot_out)
+		snapshot_write(snapshot_out, f);
+	if (snapshot_in)
+		difffile(c, f);
+	else
+		printfile(f, c->slots);
+	return 0;
+}
+
+/**
+ * list_slots - List all the files in slots (and spilled runs)
+ * @s:       File information slots (sorted)
+ * @dirname: Base direcotry name ("" for command line arguments)
+ */
+static void list_slots(struct fileslots *s, char const *dirname)
+{
+	struct listcursor c = { .slots = s };
+	size_t i;
+
+	if (!snapshot_out && !snapshot_in && !s->nruns) {
+		printfiles_slots(s);
+		return;
+	}
+
+	if (snapshot_out)
+		snapshot_begin(snapshot_out, dirname);
+	if (snapshot_in) {
+		if (snapshot_seek(snapshot_in, dirname))
+			file_failure(SNAPSHOT_FAILURE, diff_snapshot);
+		next_old(&c);
+	}
+
+	if (!s->nruns) {
+		for (i = 0; i < s->unused_index; i++)
+			listfile(s->sorted[i], &c);
+	} else if (spill_merge(s->runs, s->nruns, s->sorted, s->unused_index,
+				compare_name, listfile, &c)) {
+		file_failure(SPILL_FAILURE, NULL);
+	}
+
+	while (c.has_old) {
+		printdiff('-', &c.old, s);
+		next_old(&c);
+	}
+	if (snapshot_out)
+		snapshot_end(snapshot_out);
+}
+
+/**
+ * release_slots - release the entries in file information slots
+ * @s: File information slots
+ *
+ * The column widths are kept, since they cover spilled runs too.
  * WARN: files slots will not release.
  */
-static void clear_slots(void)
+static void release_slots(struct fileslots *s)
 {
 	int i;
 
-	nlink_width = 0;
-	user_width = 0;
-	group_width = 0;
-	file_size_width = 0;
-	time_width = 0;
+	for (i = 0; i < s->unused_index; i++)
+		free(s->files[i].name);
+	s->unused_index = 0;
+	s->memory = 0;
+	s->heaped = false;
+}
 
-	for (i = 0; i < unused_index; i++)
-		free(files[i].name);
-	unused_index = 0;
+/**
+ * clear_slots - clean up file information slots
+ * @s: File information slots
+ *
+ * WARN: files slots will not release.
+ */
+static void clear_slots(struct fileslots *s)
+{
+	s->nlink_width = 0;
+	s->user_width = 0;
+	s->group_width = 0;
+	s->file_size_width = 0;
+	s->time_width = 0;
+	s->xattr_width = 0;
+	s->context_width = 0;
+
+	release_slots(s);
+	spill_close(s->runs, s->nruns);
+	s->nruns = 0;
+	s->nospill = false;
 }
 
 /**
  * clean_slots - clean up all file information slots
+ * @s: File information slots
  *
  * WARN: Be sure clean up list when use slots.
  */
-static void clean_slots(void)
+static void clean_slots(struct fileslots *s)
 {
-	clear_slots();
-	free(sorted);
-	free(files);
+	clear_slots(s);
+	free(s->sorted);
+	free(s->files);
+	memset(s, '\0', sizeof(*s));
+}
+
+/**
+ * compare_slots - Compare files in slots (total order of compare_name())
+ * @a:   fileinfo pointer
+ * @b:   fileinfo pointer
+ *
+ * Files comparing equal (e.g. same command line argument given twice)
+ * are ordered by their position in slots, so that no two files are
+ * equal, and serial and parallel sort give the same order.
+ *
+ * Return:  1 - earlier than
+ *         -1 - later than
+ */
+static int compare_slots(const void *a, const void *b)
+{
+	struct fileinfo *ai = *(struct fileinfo**)a;
+	struct fileinfo *bi = *(struct fileinfo**)b;
+	int ret = compare_name(a, b);
+
+	if (!ret)
+		ret = (ai > bi) - (ai < bi);
+	return ret;
 }
 
 /**
  * sortfiles_slots - sort files now in the file information slots
+ * @s: File information slots
+ *
+ * Large slots are sorted by multiple threads (see psort()).
  */
-static void sortfiles_slots(void)
+static void sortfiles_slots(struct fileslots *s)
 {
 	int i;
-	for (i = 0 ; i < unused_index; i++)
-		sorted[i] = &files[i];
-	qsort((void const **)sorted, unused_index, sizeof(struct fileinfo*),
-															compare_name);
+	for (i = 0 ; i < s->unused_index; i++)
+		s->sorted[i] = &s->files[i];
+	psort((void **)s->sorted, s->unused_index, compare_slots);
+}
+
+/**
+ * spill_slots - Write the sorted slots to a temporary run, and empty slots
+ * @s: File information slots
+ *
+ * If a temporary file cannot be used, `--memory-limit` is given up and
+ * the entries stay in memory.
+ */
+static void spill_slots(struct fileslots *s)
+{
+	int i;
+	int err = 0;
+	FILE *run;
+
+	if (s->nruns == SPILL_MAX_RUNS)
+		err = spill_collapse(s->runs, &s->nruns, compare_name);
+
+	run = err ? NULL : spill_create();
+	if (!run)
+		goto failed;
+
+	sortfiles_slots(s);
+	for (i = 0; i < s->unused_index && !err; i++)
+		err = spill_write(run, s->sorted[i]);
+	if (err || fflush(run)) {
+		fclose(run);
+		goto failed;
+	}
+
+	s->runs[s->nruns++] = run;
+	release_slots(s);
+	return;
+
+failed:
+	file_failure(SPILL_FAILURE, NULL);
+	s->nospill = true;
+}
+
+/**
+ * select_worse - Check whether `a` is printed out of range before `b`
+ * @a: File information
+ * @b: File information
+ *
+ * Return: true  - `a` is later than `b` ("--head"),
+ *                 or earlier than `b` ("--tail")
+ *         false - otherwise
+ */
+static inline bool select_worse(const struct fileinfo *a,
+					const struct fileinfo *b)
+{
+	int cmp = compare_name(&a, &b);
+
+	return select_tail ? cmp < 0 : cmp > 0;
+}
+
+/**
+ * select_siftdown - Restore heap of selected entries from position `i`
+ * @heap: heap (the worst entry at the top)
+ * @n:    count of entries in heap
+ * @i:    position to sift down
+ */
+static void select_siftdown(struct fileinfo **heap, size_t n, size_t i)
+{
+	for (;;) {
+		size_t l = 2 * i + 1;
+		size_t m = i;
+		struct fileinfo *tmp;
+
+		if (l < n && select_worse(heap[l], heap[m]))
+			m = l;
+		if (l + 1 < n && select_worse(heap[l + 1], heap[m]))
+			m = l + 1;
+		if (m == i)
+			return;
+		tmp = heap[i];
+		heap[i] = heap[m];
+		heap[m] = tmp;
+		i = m;
+	}
+}
+
+/**
+ * select_slots - Drop the entry which "--head"/"--tail" will never print
+ * @s: File information slots
+ *
+ * Called each time a entry is added. Once the slots hold more than
+ * `select_count` entries, `sorted` is used as a heap with the worst
+ * selected entry at the top, and the worse of it and the new entry
+ * is released. Retained entries are bounded by `select_count`, and
+ * selection costs O(n log N) instead of a full sort.
+ */
+static void select_slots(struct fileslots *s)
+{
+	struct fileinfo *new, *worst;
+	size_t i;
+
+	if (s->unused_index <= select_count)
+		return;
+
+	new = &s->files[select_count];
+	if (!select_count) {
+		free(new->name);
+		s->unused_index = 0;
+		return;
+	}
+
+	if (!s->heaped) {
+		for (i = 0; i < select_count; i++)
+			s->sorted[i] = &s->files[i];
+		for (i = select_count / 2; i-- > 0; )
+			select_siftdown(s->sorted, select_count, i);
+		s->heaped = true;
+	}
+
+	worst = s->sorted[0];
+	if (select_worse(worst, new)) {
+		free(worst->name);
+		*worst = *new;
+		select_siftdown(s->sorted, select_count, 0);
+	} else {
+		free(new->name);
+	}
+	s->unused_index = select_count;
+}
+
+/**
+ * already_listed - Check whether directory is already listed ('--dedupe')
+ * @f: File information of directory
+ *
+ * The directory is identified by (st_dev, st_ino), so that it is
+ * detected even when reached by another name (or through a cycle).
+ *
+ * Return: true  - directory should be skipped (reported)
+ *         false - first visit, or '--dedupe' is not specified
+ */
+static bool already_listed(const struct fileinfo *f)
+{
+	if (!dedupe_dirs)
+		return false;
+
+	/* If the set cannot grow, the directory is simply listed again */
+	if (add_visited(f->status.st_dev, f->status.st_ino) != ALREADY_VISITED)
+		return false;
+
+	if (summarize_errors)
+		error_record(0, _("not listing already-listed directory"),
+							"", f->name);
+	else
+		error(0, _("%s: %s: not listing already-listed directory"),
+						PROGRAM_NAME, f->name);
+	return true;
 }
 
 /**
  * extractfiles_fromdir - Remove directory and set directory entries
+ * @s:       File information slots
  * @dirname: Base direcotry name
  */
-static void extractfiles_fromdir(char const *dirname)
+static void extractfiles_fromdir(struct fileslots *s, char const *dirname)
 {
 	int i, j;
-	for (i = 0; i < unused_index; i++) {
-		struct fileinfo *f = sorted[i];
+	for (i = 0; i < s->unused_index; i++) {
+		struct fileinfo *f = s->sorted[i];
 
-		if (S_ISDIR(f->status.st_mode))
+		if (S_ISDIR(f->status.st_mode) && !already_listed(f))
 			add_list(f->name, strlen(f->name) + 1);
 	}
 
-	for (i = 0, j = 0; i < unused_index; i++)
+	for (i = 0, j = 0; i < s->unused_index; i++)
 	{
 		bool is_command_arg_direcory;
-		struct fileinfo *f = sorted[i];
-		sorted[j] = f;
+		struct fileinfo *f = s->sorted[i];
+		s->sorted[j] = f;
 		is_command_arg_direcory = f->is_command_arg &&
 							S_ISDIR(f->status.st_mode);
 		j += !(is_command_arg_direcory);
 		if (is_command_arg_direcory)
 			free(f->name);
 	}
-	unused_index = j;
+	s->unused_index = j;
 }
 
 /**
- * print_dir - Read directory name, and list the files in it.
+ * entry_wanted - Check whether a directory entry is kept, before its status
+ * @entry: File name
+ * @type:  d_type of entry (DT_UNKNOWN if not known)
+ *
+ * Return: false if the entry is ignored, or of a type not listed
+ */
+static bool entry_wanted(char const *entry, unsigned char type)
+{
+	return !file_ignored(entry) &&
+			(!filtering || filter_dtype(&filter, type));
+}
+
+/**
+ * read_entry - Add a directory entry to slots, unless ignored
+ * @s:     File information slots
+ * @fd:    Base direcotry file descriptor
+ * @entry: File name
+ * @type:  d_type of entry (DT_UNKNOWN if not known)
+ * @name:  Base direcotry name
+ *
+ * Entries of types not listed by '--type' are dropped before their
+ * status is read.
+ */
+static void read_entry(struct fileslots *s, int fd, char const *entry,
+					unsigned char type, char const *name)
+{
+	if (!entry_wanted(entry, type))
+		return;
+	if (s->limit && !select_enabled && !s->nospill &&
+		s->unused_index &&
+		s->memory + slot_cost(entry) > s->limit)
+		spill_slots(s);
+	addfiles_slots(s, fd, entry, name, false);
+	if (select_enabled)
+		select_slots(s);
+}
+
+/**
+ * append_name - Append a name to names
+ * @names: names (each terminated by '\0', and followed by its d_type),
+ *         reallocated as needed
+ * @len:   bytes of `names`
+ * @size:  allocated bytes of `names`
+ * @name:  File name
+ * @type:  d_type of file
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE), `names` is released
+ */
+static int append_name(char **names, size_t *len, size_t *size,
+					char const *name, unsigned char type)
+{
+	size_t n = strlen(name) + 1;
+
+	if (*len + n + 1 > *size) {
+		size_t newsize = *size ? *size * 2 : 4096;
+		char *p;
+
+		while (newsize < *len + n + 1)
+			newsize *= 2;
+		p = realloc(*names, newsize);
+		if (!p) {
+			free(*names);
+			*names = NULL;
+			return ALLOCATION_FAILURE;
+		}
+		*names = p;
+		*size = newsize;
+	}
+	memcpy(*names + *len, name, n);
+	(*names)[*len + n] = type;
+	*len += n + 1;
+	return 0;
+}
+
+/**
+ * read_dir - Read directory name, and set the sorted files in it to slots.
+ * @s:    File information slots
  * @name: Base direcotry name
+ *
+ * Names are read in batches of READ_BATCH, and then their status is
+ * read. With '--daemon', the names are taken from the cache of directory
+ * entries while the directory is unchanged. The status of files is
+ * always read, since it does not change the directory.
+ *
+ * Return: 0 - success
+ *         otherwise - errno of opening (or reading) directory
  */
-static void print_dir(char const *name)
+static int read_dir(struct fileslots *s, char const *name)
 {
 	DIR *dirp;
+	struct dirent *next = NULL;
+	struct stat status;
+	char *names = NULL, *entry;
+	size_t len = 0, size = 0, start = 0, batch;
+	bool cache, cached = false;
+	uint64_t t;
+
+	clear_slots(s);
+	t = trace_begin();
+	ratelimit_take(1);
+	dirp = opendir(name);
+	if (!dirp) {
+		int err = errno;
+		trace_end("open", name, t);
+		return err;
+	}
+	cache = use_dircache && !fstat(dirfd(dirp), &status);
+	if (cache)
+		cached = (names = dircache_get(&status, &len)) != NULL;
+	trace_end("open", name, t);
+
+	do {
+		if (!cached) {
+			/* a batch takes about one getdents() */
+			ratelimit_take(1);
+			t = trace_begin();
+			start = cache ? len : 0;
+			len = start;
+			for (batch = 0; batch < READ_BATCH &&
+				(next = readdir(dirp)) != NULL; batch++) {
+				if (append_name(&names, &len, &size,
+						next->d_name, next->d_type)) {
+					closedir(dirp);
+					return ENOMEM;
+				}
+			}
+			trace_end("read", name, t);
+		}
+
+		t = trace_begin();
+		for (entry = names + start; entry < names + len;
+						entry += strlen(entry) + 2)
+			read_entry(s, dirfd(dirp), entry,
+					entry[strlen(entry) + 1], name);
+		trace_end("stat", name, t);
+	} while (!cached && next);
+
+	if (cache && !cached)
+		dircache_put(&status, names, len);
+	free(names);
+
+	t = trace_begin();
+	sortfiles_slots(s);
+	trace_end("sort", name, t);
+	closedir(dirp);
+	return 0;
+}
+
+/**
+ * print_dirname - Print directory name, before its contents.
+ * @name: Base direcotry name
+ */
+static void print_dirname(char const *name)
+{
+	if (position.printed)
+		putc('\n', output);
+	position.printed = true;
+	quote_name(output, name);
+	fputs(":\n", output);
+}
+
+/**
+ * flush_errors - Write batched error messages, after the output before them
+ *
+ * Messages are batched only within a directory, so that they keep their
+ * place in the output (e.g. "2>&1"), and are not lost if the process is
+ * killed before exit.
+ */
+static void flush_errors(void)
+{
+	if (!error_pending())
+		return;
+	fflush(output);
+	flush_writer();
+	error_flush();
+}
+
+/**
+ * print_slots - Print directory name, and list the files read in slots.
+ * @s:    File information slots
+ * @name: Base direcotry name
+ * @err:  result of read_dir()
+ */
+static void print_slots(struct fileslots *s, char const *name, int err)
+{
+	uint64_t t;
+
+	/* messages of reading directory come before its listing */
+	flush_errors();
+	if (err) {
+		errno = err;
+		entry_failure(OPENDIRECTRY_FAILURE, "", name);
+		goto out;
+	}
+
+	t = trace_begin();
+	print_dirname(name);
+	list_slots(s, name);
+	trace_end("format", name, t);
+
+	/* with '--trace', the output of directory is written now */
+	if (trace_file) {
+		t = trace_begin();
+		fflush(output);
+		trace_end("write", name, t);
+	}
+out:
+	flush_errors();
+}
+
+/**
+ * Classes of entries by age of modification time ("--estimate")
+ */
+static const struct {
+	const char *label;
+	time_t age;
+} age_classes[] = {
+	{"age < 1 day", 24 * 60 * 60},
+	{"age < 1 week", 7 * 24 * 60 * 60},
+	{"age < 30 days", 30 * 24 * 60 * 60},
+	{"age < 1 year", 365 * 24 * 60 * 60},
+	{"age >= 1 year", 0}
+};
+#define AGE_CLASSES	(sizeof(age_classes) / sizeof(age_classes[0]))
+
+/**
+ * print_estimate - Print estimated total, and its confidence bound
+ * @label: Name of the quantity
+ * @sum:   Sum of the quantity over the sample
+ * @n:     Count of entries in `sum`
+ */
+static void print_estimate(char const *label, const struct sample_sum *sum,
+								size_t n)
+{
+	double bound;
+	double total = sample_total(sum, n, sample.seen, &bound);
+
+	if (bound < 0)
+		fprintf(output, "%s: %.0f +/- ?\n", label, total);
+	else
+		fprintf(output, "%s: %.0f +/- %.0f\n", label, total, bound);
+}
+
+/**
+ * estimate_dir - Read directory name, and estimate its contents.
+ * @name: Base direcotry name
+ *
+ * All entries are read and counted, but the status is read only for a
+ * random sample of `estimate_count` entries. Total size, count of
+ * directories and count of entries by age are extrapolated from the
+ * sample, with 95% confidence bounds. Nothing is kept in slots.
+ *
+ * Entries are dropped before sampling as in read_dir() (entry_wanted()).
+ * The predicates on status apply to the sampled entries, and the others
+ * count as zero, so that the totals are scaled by the fraction matching.
+ */
+static void estimate_dir(char const *name)
+{
+	struct sample_sum size = {0}, dirs = {0}, ages[AGE_CLASSES] = {{0}};
+	struct sample_sum matching = {0};
+	struct timespec now;
 	struct dirent *next;
-	static bool first = true;
+	struct stat status;
+	DIR *dirp;
+	size_t i, j, k, n = 0, entries = 0;
+	uint64_t t;
 
+	clear_sample(&sample);
+	t = trace_begin();
+	ratelimit_take(1);
 	dirp = opendir(name);
+	trace_end("open", name, t);
 	if (!dirp) {
-		file_failure(OPENDIRECTRY_FAILURE, name);
+		entry_failure(OPENDIRECTRY_FAILURE, "", name);
+		goto out;
+	}
+
+	t = trace_begin();
+	while ((next = readdir(dirp)) != NULL) {
+		/* paced like read_dir(), a batch at a time */
+		if (!(entries++ % READ_BATCH))
+			ratelimit_take(1);
+		if (!entry_wanted(next->d_name, next->d_type))
+			continue;
+		if (sample_add(&sample, next->d_name)) {
+			closedir(dirp);
+			file_failure(ALLOCATION_FAILURE, NULL);
+			leave(ALLOCATION_FAILURE);
+		}
+	}
+	trace_end("read", name, t);
+
+	t = trace_begin();
+	clock_gettime(CLOCK_REALTIME, &now);
+	for (i = 0; i < sample.count; i++) {
+		char const *entry = sample.names[i];
+		bool kept;
+		time_t age;
+
+		if (stat_entry(dirfd(dirp), entry, &status)) {
+			char *path = alloca(strlen(entry) + strlen(name) + 2);
+			joinpath(path, name, entry);
+			entry_failure(ACCESS_FAILURE, name, path);
+			continue;
+		}
+		/* entries not matching count as zero, scaling the totals */
+		kept = !filtering || filter_status(&filter, &status);
+		n++;
+		sample_add_value(&matching, kept);
+		sample_add_value(&size, kept ? status.st_size : 0);
+		sample_add_value(&dirs, kept && S_ISDIR(status.st_mode));
+		age = now.tv_sec - status.st_mtime;
+		for (j = 0; j < AGE_CLASSES - 1; j++)
+			if (age < age_classes[j].age)
+				break;
+		for (k = 0; k < AGE_CLASSES; k++)
+			sample_add_value(&ages[k], kept && k == j);
+	}
+	closedir(dirp);
+	trace_end("stat", name, t);
+
+	t = trace_begin();
+	flush_errors();
+	print_dirname(name);
+	fprintf(output, _("entries: %ju (sampled %zu)\n"),
+					(uintmax_t)sample.seen, n);
+	if (filtering)
+		print_estimate(_("matching"), &matching, n);
+	print_estimate(_("size"), &size, n);
+	print_estimate(_("directories"), &dirs, n);
+	for (j = 0; j < AGE_CLASSES; j++)
+		print_estimate(_(age_classes[j].label), &ages[j], n);
+	trace_end("format", name, t);
+out:
+	flush_errors();
+}
+
+/**
+ * write_checkpoint - Save pending directories to checkpoint ('--checkpoint')
+ *
+ * The output is written out first, so that the directories printed
+ * before the checkpoint are never listed again by '--resume'.
+ */
+static void write_checkpoint(void)
+{
+	fflush(output);
+	flush_writer();
+	if (save_checkpoint(checkpoint_file, inflight, ninflight, &position))
+		file_failure(CHECKPOINT_FAILURE, checkpoint_file);
+	clock_gettime(CLOCK_MONOTONIC, &checkpoint_time);
+}
+
+/**
+ * take_dir - Record directory taken from queue, until it is printed
+ * @name: Base direcotry name (kept until done_dir())
+ */
+static void take_dir(char *name)
+{
+	if (checkpoint_file)
+		inflight[ninflight++] = name;
+}
+
+/**
+ * done_dir - Record the oldest directory taken from queue as printed
+ *
+ * Checkpoint is written if CHECKPOINT_INTERVAL has passed since the last.
+ */
+static void done_dir(void)
+{
+	struct timespec now;
+
+	position.done++;
+	if (!checkpoint_file)
+		return;
+
+	memmove(inflight, inflight + 1, --ninflight * sizeof(*inflight));
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec - checkpoint_time.tv_sec >= CHECKPOINT_INTERVAL)
+		write_checkpoint();
+}
+
+/**
+ * print_dir - Read directory name, and list the files in it.
+ * @name: Base direcotry name
+ */
+static void print_dir(char const *name)
+{
+	if (estimate_count) {
+		estimate_dir(name);
 		return;
 	}
+	print_slots(&slots, name, read_dir(&slots, name));
+}
 
-	if (!first)
-		putchar('\n');
-	first = false;
-	fprintf(stdout, "%s:\n", name);
+/**
+ * prepare_listing - Read directory of listing (`prepare` of pipeline)
+ * @arg: listing
+ *
+ * Called from reader threads of '--prefetch'. Without '--memory-limit',
+ * the directories read ahead share PREFETCH_MEMORY. Messages are
+ * deferred until the directory is printed.
+ */
+static void prepare_listing(void *arg)
+{
+	struct listing *l = arg;
 
-	clear_slots();
-	while ((next = readdir(dirp)) != NULL) {
-		if (!file_ignored(next->d_name))
-			addfiles_slots(next->d_name, name, false);
+	memset(&l->errors, '\0', sizeof(l->errors));
+	/* reported as the failure of directory, by the main thread */
+	if (init_slots(&l->slots)) {
+		l->err = ENOMEM;
+		return;
 	}
+	if (!l->slots.limit && prefetch_count && !merge_dirs)
+		l->slots.limit = PREFETCH_MEMORY / prefetch_count;
+	error_defer(&l->errors);
+	l->err = read_dir(&l->slots, l->dirname);
+	error_defer(NULL);
+}
 
-	sortfiles_slots();
-	closedir(dirp);
-	printfiles_slots();
+/**
+ * print_dirs_prefetch - List directories in queue, reading ahead.
+ *
+ * While the main thread prints a directory, reader threads read, stat
+ * and sort the next `prefetch_count` directories of the queue.
+ * Directories are printed in the order of the queue. If memory runs
+ * out, the rest of the queue is left to be listed without reading ahead.
+ */
+static void print_dirs_prefetch(void)
+{
+	struct pipeline *pl;
+	struct listing *l;
+	bool reading = true;
+
+	init_messages();
+	pl = init_pipeline(prefetch_count, prepare_listing);
+	if (!pl)
+		return;
+
+	while ((reading && get_listcount()) || pipeline_count(pl)) {
+		while (reading && get_listcount() && !pipeline_full(pl)) {
+			size_t len = get_length();
+
+			l = malloc(sizeof(*l));
+			if (l)
+				l->dirname = malloc(len * sizeof(char));
+			if (!l || !l->dirname) {
+				free(l);
+				reading = false;
+				break;
+			}
+			get_list(l->dirname, len);
+			take_dir(l->dirname);
+			pipeline_submit(pl, l);
+		}
+
+		l = pipeline_next(pl);
+		if (!l)
+			break;
+		error_replay(&l->errors);
+		print_slots(&l->slots, l->dirname, l->err);
+		done_dir();
+		clean_slots(&l->slots);
+		free(l->dirname);
+		free(l);
+	}
+
+	clean_pipeline(pl);
 }
 
-int main(int argc, char *argv[])
+/**
+ * struct mergecursor - Next entry of a directory in merged listing.
+ * @l:     listing of directory
+ * @index: order of directory in queue (for the files of the same name)
+ * @pos:   index of next entry in `l->slots.sorted`
+ */
+struct mergecursor {
+	struct listing *l;
+	size_t index;
+	size_t pos;
+};
+
+/**
+ * merge_before - Check whether next entry of `a` is listed before `b`'s
+ * @a: cursor
+ * @b: cursor
+ *
+ * Return: true  - `a` is earlier than `b`
+ *         false - otherwise
+ */
+static inline bool merge_before(const struct mergecursor *a,
+					const struct mergecursor *b)
+{
+	const struct fileinfo *fa = a->l->slots.sorted[a->pos];
+	const struct fileinfo *fb = b->l->slots.sorted[b->pos];
+	int cmp = compare_name(&fa, &fb);
+
+	return cmp ? cmp < 0 : a->index < b->index;
+}
+
+/**
+ * merge_siftdown - Restore heap of cursors from position `i`
+ * @heap: heap (the earliest entry at the top)
+ * @n:    count of cursors in heap
+ * @i:    position to sift down
+ */
+static void merge_siftdown(struct mergecursor *heap, size_t n, size_t i)
+{
+	for (;;) {
+		size_t l = 2 * i + 1;
+		size_t m = i;
+		struct mergecursor tmp;
+
+		if (l < n && merge_before(&heap[l], &heap[m]))
+			m = l;
+		if (l + 1 < n && merge_before(&heap[l + 1], &heap[m]))
+			m = l + 1;
+		if (m == i)
+			return;
+		tmp = heap[i];
+		heap[i] = heap[m];
+		heap[m] = tmp;
+		i = m;
+	}
+}
+
+/**
+ * merge_widths - Widen the columns of `dest` to cover slots `s`
+ * @dest: File information slots holding the column widths
+ * @s:    File information slots
+ */
+static void merge_widths(struct fileslots *dest, const struct fileslots *s)
+{
+	if (dest->nlink_width < s->nlink_width)
+		dest->nlink_width = s->nlink_width;
+	if (dest->user_width < s->user_width)
+		dest->user_width = s->user_width;
+	if (dest->group_width < s->group_width)
+		dest->group_width = s->group_width;
+	if (dest->file_size_width < s->file_size_width)
+		dest->file_size_width = s->file_size_width;
+	if (dest->time_width < s->time_width)
+		dest->time_width = s->time_width;
+	if (dest->xattr_width < s->xattr_width)
+		dest->xattr_width = s->xattr_width;
+	if (dest->context_width < s->context_width)
+		dest->context_width = s->context_width;
+}
+
+/**
+ * print_dirs_merged - List directories in queue as one listing ('--merge')
+ *
+ * Each directory is read and sorted in its own slots ('--prefetch'
+ * threads read them in parallel). Then the sorted slots are merged by a
+ * heap of cursors, and each file is printed after the name of the
+ * directory it belongs to, so that the union is listed in sorted order
+ * without sorting it again.
+ */
+static void print_dirs_merged(void)
+{
+	size_t count = get_listcount();
+	struct listing *ls = calloc(count, sizeof(*ls));
+	struct mergecursor *heap = malloc(count * sizeof(*heap));
+	struct pipeline *pl = NULL;
+	struct fileslots widths;
+	size_t i, n = 0;
+	size_t width = 0, quoted;
+
+	if (!ls || !heap)
+		goto nomem;
+	/* names are taken before reader threads start */
+	for (i = 0; i < count; i++) {
+		size_t len = get_length();
+
+		ls[i].dirname = malloc(len * sizeof(char));
+		if (!ls[i].dirname)
+			goto nomem;
+		get_list(ls[i].dirname, len);
+	}
+	if (prefetch_count) {
+		init_messages();
+		pl = init_pipeline(prefetch_count, prepare_listing);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!pl) {
+			prepare_listing(&ls[i]);
+			continue;
+		}
+		if (pipeline_full(pl))
+			pipeline_next(pl);
+		pipeline_submit(pl, &ls[i]);
+	}
+	if (pl)
+		clean_pipeline(pl);
+
+	memset(&widths, '\0', sizeof(widths));
+	for (i = 0; i < count; i++) {
+		struct fileslots *s = &ls[i].slots;
+
+		error_replay(&ls[i].errors);
+		if (ls[i].err) {
+			errno = ls[i].err;
+			entry_failure(OPENDIRECTRY_FAILURE, "", ls[i].dirname);
+			continue;
+		}
+		if (!s->unused_index)
+			continue;
+		merge_widths(&widths, s);
+		if (width < quote_name(NULL, ls[i].dirname))
+			width = quote_name(NULL, ls[i].dirname);
+		heap[n].l = &ls[i];
+		heap[n].index = i;
+		heap[n].pos = 0;
+		n++;
+	}
+	for (i = n / 2; i-- > 0; )
+		merge_siftdown(heap, n, i);
+
+	flush_errors();
+	while (n) {
+		struct mergecursor *c = &heap[0];
+
+		quoted = quote_name(output, c->l->dirname);
+		fprintf(output, "%*s  ", (int)(width - quoted), "");
+		printer->entry(output, &widths, c->l->slots.sorted[c->pos]);
+		putc('\n', output);
+		if (++c->pos == c->l->slots.unused_index)
+			heap[0] = heap[--n];
+		merge_siftdown(heap, n, 0);
+	}
+
+	flush_errors();
+	for (i = 0; i < count; i++) {
+		clean_slots(&ls[i].slots);
+		free(ls[i].dirname);
+	}
+	free(heap);
+	free(ls);
+	return;
+
+nomem:
+	for (i = 0; ls && i < count; i++)
+		free(ls[i].dirname);
+	free(heap);
+	free(ls);
+	file_failure(ALLOCATION_FAILURE, NULL);
+	leave(ALLOCATION_FAILURE);
+}
+
+static int list_files(int argc, char *argv[]);
+
+/**
+ * clean_listing - Release the resources of list_files()
+ *
+ * Called when the listing ends, and when a request of '--daemon' is left
+ * early by leave(), so that a failed request leaks nothing. Resources
+ * not yet allocated (or already released) are skipped.
+ */
+static void clean_listing(void)
+{
+	clean_writer();
+	output = stdout;
+	clean_trace();
+	snapshot_close(snapshot_in);
+	snapshot_in = NULL;
+	/* a snapshot not committed is discarded */
+	snapshot_close(snapshot_out);
+	snapshot_out = NULL;
+	clean_list();
+	clean_visited();
+	clean_slots(&slots);
+	clean_sample(&sample);
+	/* user and group names are kept for next request of '--daemon' */
+	if (!serving)
+		clean_idcache();
+	clean_colors();
+	clean_patterns(ignore_patterns);
+	clean_patterns(hide_patterns);
+	ignore_patterns = NULL;
+	hide_patterns = NULL;
+}
+
+/**
+ * serve_request - List FILEs of a request ('--daemon')
+ * @argc: count of arguments
+ * @argv: arguments of client
+ *
+ * Failures which would exit the process end only the request.
+ *
+ * Return: exit status of request
+ */
+static int serve_request(int argc, char *argv[])
+{
+	jmp_buf env;
+	int status;
+
+	request_exit = &env;
+	if (setjmp(env)) {
+		status = request_status;
+		/* failures before leaving are still reported to the client */
+		if (summarize_errors)
+			error_summary();
+		/* the trace of a request left early is written as is */
+		clean_listing();
+	} else
+		status = list_files(argc, argv);
+	request_exit = NULL;
+	return status;
+}
+
+/**
+ * serve_daemon - Serve listings on socket until error ('--daemon')
+ *
+ * Requests are served one at a time, writing to the standard output and
+ * error of the client, in its working directory and environment. The process keeps the
+ * names of users and groups, and the entries of unchanged directories,
+ * between requests.
+ *
+ * Return: exit status
+ */
+static int serve_daemon(void)
+{
+	char const *path = daemon_socket;
+	struct daemon_request req;
+	int fd, out, err;
+
+	fd = daemon_listen(path);
+	if (fd < 0) {
+		file_failure(DAEMON_FAILURE, path);
+		return DAEMON_FAILURE;
+	}
+	out = dup(STDOUT_FILENO);
+	err = dup(STDERR_FILENO);
+	/* client may close its output while listing */
+	signal(SIGPIPE, SIG_IGN);
+	init_dircache(DIRCACHE_LIMIT);
+	use_dircache = true;
+	serving = true;
+	fflush(stdout);
+
+	while (!daemon_accept(fd, &req)) {
+		int status;
+
+		/* locale and TZ of the client, as a process of its own */
+		setlocale(LC_ALL, "C");
+		messages_loaded = false;
+		tzset();
+		dup2(req.out, STDOUT_FILENO);
+		dup2(req.err >= 0 ? req.err : req.out, STDERR_FILENO);
+		if (chdir(req.cwd)) {
+			file_failure(ACCESS_FAILURE, req.cwd);
+			status = ACCESS_FAILURE;
+		} else {
+			status = serve_request(req.argc, req.argv);
+		}
+		fflush(stdout);
+		clearerr(stdout);
+		error_flush();
+		dup2(out, STDOUT_FILENO);
+		dup2(err, STDERR_FILENO);
+		daemon_reply(&req, status);
+	}
+
+	serving = false;
+	file_failure(DAEMON_FAILURE, path);
+	clean_dircache();
+	close(fd);
+	return DAEMON_FAILURE;
+}
+
+/**
+ * list_files - List FILEs of command line
+ * @argc: count of arguments
+ * @argv: arguments
+ *
+ * Return: exit status
+ */
+static int list_files(int argc, char *argv[])
 {
 	int i;
 	int optind;
 	int n_files;
 
-	setlocale (LC_ALL, "");
-	bindtextdomain (PACKAGE, LOCALEDIR);
-	textdomain (PACKAGE);
-
 	optind = decode_cmdline(argc, argv);
 	n_files = argc - optind;
+	resolve_modes();
+	init_quote(quoting_style, hide_control);
+	/* month names of long format */
+	if (print_format == PRINT_LONG_FORMAT)
+		setlocale (LC_TIME, "");
+
+	if (!serving && daemon_socket)
+		return serve_daemon();
+	if (!serving && connect_socket) {
+		int status = daemon_call(connect_socket, argc, argv);
+		if (status >= 0)
+			return status;
+		if (status < -1) {
+			file_failure(DAEMON_FAILURE, connect_socket);
+			return DAEMON_FAILURE;
+		}
+		/* daemon is not running, list by ourselves */
+	}
 
-	init_slots();
-	init_list();
-	alloc_count = ALLOCATE_COUNT;
+	position.printed = false;
+	position.done = 0;
+	ninflight = 0;
+	snapshot_in = NULL;
+	snapshot_out = NULL;
+	if (summarize_errors)
+		init_errors(ERROR_EXAMPLES);
+
+	if (trace_file && init_trace(trace_file)) {
+		file_failure(TRACE_FAILURE, trace_file);
+		leave(TRACE_FAILURE);
+	}
+	if (stat_timeout)
+		init_timedstat(stat_timeout);
+	init_ratelimit(max_iops, max_burst, print_stats);
+	if (probe_xattr)
+		init_xattr(stat_timeout != 0);
+	if (print_with_color && init_colors(getenv("LS_COLORS"))) {
+		file_failure(ALLOCATION_FAILURE, NULL);
+		leave(ALLOCATION_FAILURE);
+	}
+	if (diff_snapshot &&
+		!(snapshot_in = snapshot_open(diff_snapshot, snapshot_sort()))) {
+		file_failure(SNAPSHOT_FAILURE, diff_snapshot);
+		leave(SNAPSHOT_FAILURE);
+	}
+	if (save_snapshot &&
+		!(snapshot_out = snapshot_create(save_snapshot, snapshot_sort()))) {
+		file_failure(SNAPSHOT_FAILURE, save_snapshot);
+		leave(SNAPSHOT_FAILURE);
+	}
 
-	files = malloc (alloc_count * (sizeof(*files)));
-	if (!files) {
+	if (estimate_count && init_sample(&sample, estimate_count)) {
 		file_failure(ALLOCATION_FAILURE, NULL);
-		exit(ALLOCATION_FAILURE);
+		leave(ALLOCATION_FAILURE);
 	}
-	sorted = malloc(alloc_count * (sizeof(*sorted)));
-	if (!sorted) {
+	if (init_slots(&slots) || init_list() ||
+				(dedupe_dirs && init_visited())) {
 		file_failure(ALLOCATION_FAILURE, NULL);
-		exit(ALLOCATION_FAILURE);
+		leave(ALLOCATION_FAILURE);
+	}
+
+	if (resume_listing) {
+		/* FILE arguments are already listed, before checkpoint */
+		int err = load_checkpoint(checkpoint_file, &position);
+		if (err) {
+			file_failure(CHECKPOINT_FAILURE, checkpoint_file);
+			leave(err);
+		}
+	}
+
+	output = stdout;
+	if (async_output) {
+		FILE *fp = init_writer(STDOUT_FILENO);
+		if (fp) {
+			fflush(stdout);
+			output = fp;
+		}
 	}
 
 	clock_gettime(CLOCK_MONOTONIC, &current);
 	year_ago.tv_sec = current.tv_sec - (365.2425 * 24 * 60 * 60);
 	year_ago.tv_nsec = current.tv_nsec;
 
-	if (n_files <= 0) {
-		addfiles_slots(".", "", true);
-	} else {
-		for (i = optind; i < argc; i++)
-			addfiles_slots(argv[i], "", true);
-	}
+	if (!resume_listing) {
+		if (n_files <= 0) {
+			addfiles_slots(&slots, AT_FDCWD, ".", "", true);
+		} else {
+			for (i = optind; i < argc; i++)
+				addfiles_slots(&slots, AT_FDCWD, argv[i], "", true);
+		}
 
-	if (unused_index) {
-		sortfiles_slots();
-		extractfiles_fromdir(NULL);
+		if (slots.unused_index) {
+			sortfiles_slots(&slots);
+			extractfiles_fromdir(&slots, NULL);
+		}
+		flush_errors();
+		list_slots(&slots, "");
+		flush_errors();
 	}
-	printfiles_slots();
+	if (checkpoint_file)
+		write_checkpoint();
+
+	if (merge_dirs && !estimate_count)
+		print_dirs_merged();
+	else if (prefetch_count && !estimate_count && get_listcount() > 1)
+		print_dirs_prefetch();
 
 	while (get_listcount()) {
 		size_t len = get_length();
 		char *dirname = malloc(len * sizeof(char));
+		if (!dirname) {
+			file_failure(ALLOCATION_FAILURE, NULL);
+			leave(ALLOCATION_FAILURE);
+		}
 		get_list(dirname, len);
+		take_dir(dirname);
 		print_dir(dirname);
+		done_dir();
 		free(dirname);
 	}
+	/* Completed, nothing to resume */
+	if (checkpoint_file)
+		unlink(checkpoint_file);
+
+	if (snapshot_out && snapshot_commit(snapshot_out))
+		file_failure(SNAPSHOT_FAILURE, save_snapshot);
+	snapshot_out = NULL;
+	if (output != stdout) {
+		int err = clean_writer();
+		output = stdout;
+		if (err) {
+			error(err, _("%s: write error"), PROGRAM_NAME);
+		}
+	}
+	if (clean_trace())
+		file_failure(TRACE_FAILURE, trace_file);
+	if (print_stats) {
+		fflush(stdout);
+		fprintf(stderr, _("%s: %ju metadata calls, %.3f s throttled\n"),
+			PROGRAM_NAME, (uintmax_t)ratelimit_calls(),
+			ratelimit_throttled() / 1e9);
+	}
+	if (summarize_errors) {
+		fflush(stdout);
+		error_summary();
+	}
 
-	clean_list();
-	clean_slots();
+	clean_listing();
 	return 0;
 }
+
+int main(int argc, char *argv[])
+{
+	return list_files(argc, argv);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file pattern.c
+ * @brief Compiled shell patterns for '--ignore' and '--hide'
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. set = init_patterns();
+ * 2. add_pattern(set, "*.o");
+ * 3. match_patterns(set, name);
+ * 4. clean_patterns(set);
+ *
+ * Every pattern is classified once when it is added. Patterns which are
+ * a plain literal, "PREFIX*", "*SUFFIX" or "*.EXT" are answered by
+ * memcmp(), and only the remaining ones fall back to fnmatch().
+ * The result is the same as fnmatch(pattern, name, FNM_PERIOD).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fnmatch.h>
+#include "pattern.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ *  3: argument pointer is illegal
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1,
+	ILLEGAL_ARGUMENT_FAILURE = 3
+};
+
+/**
+ * PATTERN KIND
+ * Ordered from the cheapest check to the most expensive one.
+ */
+enum
+{
+	/* "NAME": no wildcard at all */
+	PATTERN_LITERAL,
+	/* "*.EXT": compared against the last extension of the name */
+	PATTERN_EXTENSION,
+	/* "PREFIX*" */
+	PATTERN_PREFIX,
+	/* "*SUFFIX" */
+	PATTERN_SUFFIX,
+	/* anything else, evaluated by fnmatch() */
+	PATTERN_GLOB,
+	PATTERN_KINDS
+};
+
+/**
+ * struct pattern - compiled pattern.
+ * @text: literal part of pattern (whole pattern if PATTERN_GLOB)
+ * @len:  length of `text`
+ */
+struct pattern {
+	char *text;
+	size_t len;
+};
+
+/**
+ * struct pattern_set - compiled patterns grouped by kind.
+ * @list:  patterns of each kind
+ * @count: count of patterns of each kind
+ */
+struct pattern_set {
+	struct pattern *list[PATTERN_KINDS];
+	size_t count[PATTERN_KINDS];
+};
+
+/**
+ * has_wildcard - Check whether string contains shell wildcard
+ * @s:   string
+ * @len: length of string
+ *
+ * Return: true  - `s` contains '*', '?', '[' or '\'
+ *         false - `s` is literal
+ */
+static bool has_wildcard(const char *s, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		switch (s[i]) {
+		case '*':
+		case '?':
+		case '[':
+		case '\\':
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * classify_pattern - Decide pattern kind and its literal part
+ * @p:     pattern
+ * @start: output. start offset of literal part
+ * @len:   output. length of literal part
+ *
+ * Return: PATTERN KIND
+ */
+static int classify_pattern(const char *p, size_t *start, size_t *len)
+{
+	size_t plen = strlen(p);
+
+	*start = 0;
+	*len = plen;
+	if (!has_wildcard(p, plen))
+		return PATTERN_LITERAL;
+
+	if (plen >= 1 && p[plen - 1] == '*' && !has_wildcard(p, plen - 1)) {
+		*len = plen - 1;
+		return PATTERN_PREFIX;
+	}
+
+	if (plen >= 1 && p[0] == '*' && !has_wildcard(p + 1, plen - 1)) {
+		*start = 1;
+		*len = plen - 1;
+		if (plen >= 2 && p[1] == '.' && !memchr(p + 2, '.', plen - 2))
+			return PATTERN_EXTENSION;
+		return PATTERN_SUFFIX;
+	}
+
+	return PATTERN_GLOB;
+}
+
+/**
+ * init_patterns - Initialize empty pattern set
+ *
+ * Return: pattern set, NULL if it cannot be allocated
+ */
+struct pattern_set *init_patterns(void)
+{
+	return calloc(1, sizeof(struct pattern_set));
+}
+
+/**
+ * add_pattern - Compile pattern and add it to set
+ * @set: pattern set
+ * @p:   shell pattern
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int add_pattern(struct pattern_set *set, const char *p)
+{
+	int kind;
+	size_t start, len;
+	struct pattern *list, *new;
+
+	if (!set || !p)
+		return ILLEGAL_ARGUMENT_FAILURE;
+
+	kind = classify_pattern(p, &start, &len);
+	list = realloc(set->list[kind],
+			(set->count[kind] + 1) * sizeof(*list));
+	if (!list)
+		return ALLOCATION_FAILURE;
+	set->list[kind] = list;
+
+	new = &list[set->count[kind]];
+	new->text = malloc(len + 1);
+	if (!new->text)
+		return ALLOCATION_FAILURE;
+	memcpy(new->text, p + start, len);
+	new->text[len] = '\0';
+	new->len = len;
+	set->count[kind]++;
+
+	return 0;
+}
+
+/**
+ * match_patterns - Check whether name matches any pattern in set
+ * @set:  pattern set
+ * @name: File name
+ *
+ * Wildcards never match a leading '.', as with FNM_PERIOD.
+ *
+ * Return: true  - `name` matches at least one pattern
+ *         false - `name` matches no pattern
+ */
+bool match_patterns(const struct pattern_set *set, const char *name)
+{
+	size_t i, len;
+	const struct pattern *p;
+	const char *ext;
+	bool dotfile = (name[0] == '.');
+
+	if (!set)
+		return false;
+
+	len = strlen(name);
+	for (i = 0, p = set->list[PATTERN_LITERAL];
+			i < set->count[PATTERN_LITERAL]; i++, p++)
+		if (p->len == len && !memcmp(p->text, name, len))
+			return true;
+
+	if (set->count[PATTERN_EXTENSION] && !dotfile) {
+		ext = strrchr(name, '.');
+		if (ext) {
+			size_t elen = len - (ext - name);
+			for (i = 0, p = set->list[PATTERN_EXTENSION];
+					i < set->count[PATTERN_EXTENSION]; i++, p++)
+				if (p->len == elen && !memcmp(p->text, ext, elen))
+					return true;
+		}
+	}
+
+	for (i = 0, p = set->list[PATTERN_PREFIX];
+			i < set->count[PATTERN_PREFIX]; i++, p++)
+		if (p->len <= len && !memcmp(p->text, name, p->len)
+				&& (p->len || !dotfile))
+			return true;
+
+	if (!dotfile) {
+		for (i = 0, p = set->list[PATTERN_SUFFIX];
+				i < set->count[PATTERN_SUFFIX]; i++, p++)
+			if (p->len <= len &&
+				!memcmp(p->text, name + len - p->len, p->len))
+				return true;
+	}
+
+	for (i = 0, p = set->list[PATTERN_GLOB];
+			i < set->count[PATTERN_GLOB]; i++, p++)
+		if (!fnmatch(p->text, name, FNM_PERIOD))
+			return true;
+
+	return false;
+}
+
+/**
+ * empty_patterns - Check whether pattern set has no pattern
+ * @set: pattern set (may be NULL)
+ *
+ * Return: true  - no name matches `set`
+ *         false - `set` has a pattern
+ */
+bool empty_patterns(const struct pattern_set *set)
+{
+	int kind;
+
+	if (!set)
+		return true;
+
+	for (kind = 0; kind < PATTERN_KINDS; kind++)
+		if (set->count[kind])
+			return false;
+	return true;
+}
+
+/**
+ * clean_patterns - clean up pattern set
+ * @set: pattern set
+ */
+void clean_patterns(struct pattern_set *set)
+{
+	int kind;
+	size_t i;
+
+	if (!set)
+		return;
+
+	for (kind = 0; kind < PATTERN_KINDS; kind++) {
+		for (i = 0; i < set->count[kind]; i++)
+			free(set->list[kind][i].text);
+		free(set->list[kind]);
+	}
+	free(set);
+}
@@ -0,0 +1,15 @@
+#ifndef _PATTERN_H
+#define _PATTERN_H
+
+#include <stdbool.h>
+
+struct pattern_set;
+
+/* pattern.c */
+extern struct pattern_set *init_patterns(void);
+extern int add_pattern(struct pattern_set *, const char *);
+extern bool match_patterns(const struct pattern_set *, const char *);
+extern bool empty_patterns(const struct pattern_set *);
+extern void clean_patterns(struct pattern_set *);
+
+#endif
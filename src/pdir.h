@@ -28,13 +28,23 @@
  *  2: invalid command-line option
  *  3: file cannot open
  *  4: directory cannot open
+ *  5: temporary file cannot read/write
+ *  6: snapshot file cannot read/write
+ *  7: checkpoint file cannot read/write
+ *  8: socket of daemon cannot be used
+ *  9: trace file cannot write
  */
 enum
 {
 	ALLOCATION_FAILURE = 1,
 	CMDLINE_FAILURE = 2,
 	ACCESS_FAILURE = 3,
-	OPENDIRECTRY_FAILURE = 4
+	OPENDIRECTRY_FAILURE = 4,
+	SPILL_FAILURE = 5,
+	SNAPSHOT_FAILURE = 6,
+	CHECKPOINT_FAILURE = 7,
+	DAEMON_FAILURE = 8,
+	TRACE_FAILURE = 9
 };
 
 /**
@@ -43,13 +53,52 @@ enum
  */
 #define ALLOCATE_COUNT	100
 
+/**
+ * Count of names read from a directory, before their status is read.
+ */
+#define READ_BATCH	256
+
+/**
+ * Maximum count of directories read ahead ("--prefetch").
+ * Each of them holds its own slots, and a reader thread.
+ */
+#define PREFETCH_MAX	64
+
+/**
+ * Bytes of entries held by the directories read ahead ("--prefetch"),
+ * unless "--memory-limit" is given. Shared equally by the directories,
+ * beyond which each of them spills sorted runs to temporary files.
+ */
+#define PREFETCH_MEMORY	(256 * 1024 * 1024)
+
+/**
+ * Interval of writing checkpoint ("--checkpoint"), in seconds.
+ * Checked each time a directory is printed.
+ */
+#define CHECKPOINT_INTERVAL	5
+
+/**
+ * Maximum bytes of directory entries cached by "--daemon".
+ */
+#define DIRCACHE_LIMIT	(64 * 1024 * 1024)
+
+/**
+ * Default count of entries sampled in each directory ("--estimate").
+ */
+#define ESTIMATE_SAMPLE	1000
+
+/**
+ * Count of file names printed for each group of failures ("--error-summary").
+ */
+#define ERROR_EXAMPLES	3
+
 /**
  * FOR LONG FORMAT, BUFFER SIZE
  */
 enum
 {
 	/* FILETYPE "drwxrwxrwx" */
-	FILETYPE_SIZE = 11,
+	FILETYPE_SIZE = 12,
 	/* FILELINK COUNT (FIXME)*/
 	FILELINK_SIZE = 11,
 	/* USERNAME/GROUPNAME SIZE "#define UT_NAMESIZE    32" */
@@ -63,13 +112,25 @@ enum
 /**
  * struct fileinfo - File information.
  * @name:   File name
+ * @linkname: Symbolic link target (stored after `name`), NULL if unknown
+ * @context: Security context (stored after `linkname`), NULL if unknown
+ *           (only with '-Z')
+ * @key:     Sort key of `name` (stored after `context`), NULL if none
+ *           (only with '-v')
  * @status: File status
  * @is_command_arg: specified that command_line argument
+ * @unknown: status could not be read in time ('--stat-timeout')
+ * @xattr:   '+' (ACL), '.' (security context) or '\0' (none), in '-l'
  */
 struct fileinfo {
 	char *name;
+	char *linkname;
 	struct stat status;
 	bool is_command_arg;
+	bool unknown;
+	char *context;
+	char *key;
+	char xattr;
 };
 
 #endif
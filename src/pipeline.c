@@ -0,0 +1,255 @@
+/**
+ * @file pipeline.c
+ * @brief Bounded producer/consumer pipeline (jobs are returned in order)
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. pl = init_pipeline(depth, prepare);
+ * 2. pipeline_submit(pl, job); (while !pipeline_full(pl))
+ * 3. job = pipeline_next(pl); (waits until `prepare(job)` is finished)
+ * 4. clean_pipeline(pl);
+ *
+ * `depth` worker threads run `prepare` on the submitted jobs, while the
+ * caller consumes the finished jobs in the order of submission.
+ * At most `depth` jobs are in flight, which bounds the lookahead.
+ * Only one thread may submit and consume jobs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pipeline.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ *  2: pipeline is full
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1,
+	PIPELINE_FULL_FAILURE = 2
+};
+
+/**
+ * struct pipeline_slot - Job in flight.
+ * @job:   job data
+ * @ready: `prepare(job)` is finished
+ */
+struct pipeline_slot {
+	void *job;
+	bool ready;
+};
+
+/**
+ * struct pipeline - Ring of jobs in flight, and its workers.
+ * @ring:    jobs in flight (ring buffer of `depth`)
+ * @depth:   size of ring, and count of workers
+ * @head:    index of oldest job (next returned by pipeline_next())
+ * @taken:   count of jobs taken by workers, since `head`
+ * @count:   count of jobs in flight
+ * @stop:    workers should exit
+ * @prepare: job handler
+ * @threads: worker threads
+ * @nthreads: count of started workers
+ * @lock:    protects all of the above
+ * @work:    signaled when a job is submitted
+ * @done:    signaled when a job is prepared
+ */
+struct pipeline {
+	struct pipeline_slot *ring;
+	size_t depth;
+	size_t head;
+	size_t taken;
+	size_t count;
+	bool stop;
+	void (*prepare)(void *);
+	pthread_t *threads;
+	size_t nthreads;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+};
+
+/**
+ * pipeline_worker - worker thread. prepare jobs in order of submission
+ * @arg: pipeline
+ *
+ * Return: NULL
+ */
+static void *pipeline_worker(void *arg)
+{
+	struct pipeline *pl = arg;
+	struct pipeline_slot *slot;
+
+	pthread_mutex_lock(&pl->lock);
+	for (;;) {
+		while (!pl->stop && pl->taken == pl->count)
+			pthread_cond_wait(&pl->work, &pl->lock);
+		if (pl->stop)
+			break;
+
+		slot = &pl->ring[(pl->head + pl->taken) % pl->depth];
+		pl->taken++;
+		pthread_mutex_unlock(&pl->lock);
+
+		pl->prepare(slot->job);
+
+		pthread_mutex_lock(&pl->lock);
+		slot->ready = true;
+		pthread_cond_signal(&pl->done);
+	}
+	pthread_mutex_unlock(&pl->lock);
+	return NULL;
+}
+
+/**
+ * init_pipeline - Initialize pipeline and start workers
+ * @depth:   count of jobs in flight (and count of workers)
+ * @prepare: job handler, called from worker threads
+ *
+ * Return: pipeline, NULL if it cannot be allocated (or no worker starts)
+ */
+struct pipeline *init_pipeline(size_t depth, void (*prepare)(void *))
+{
+	struct pipeline *pl = calloc(1, sizeof(*pl));
+	size_t i;
+
+	if (!pl)
+		return NULL;
+	pl->ring = calloc(depth, sizeof(*pl->ring));
+	pl->threads = calloc(depth, sizeof(*pl->threads));
+	if (!pl->ring || !pl->threads)
+		goto free_pipeline;
+
+	pl->depth = depth;
+	pl->prepare = prepare;
+	pthread_mutex_init(&pl->lock, NULL);
+	pthread_cond_init(&pl->work, NULL);
+	pthread_cond_init(&pl->done, NULL);
+
+	for (i = 0; i < depth; i++) {
+		if (pthread_create(&pl->threads[i], NULL, pipeline_worker, pl))
+			break;
+		pl->nthreads++;
+	}
+	/* Without any worker, jobs would never be prepared */
+	if (!pl->nthreads)
+		goto destroy_lock;
+	return pl;
+
+destroy_lock:
+	pthread_cond_destroy(&pl->done);
+	pthread_cond_destroy(&pl->work);
+	pthread_mutex_destroy(&pl->lock);
+free_pipeline:
+	free(pl->threads);
+	free(pl->ring);
+	free(pl);
+	return NULL;
+}
+
+/**
+ * pipeline_full - Check whether lookahead is exhausted
+ * @pl: pipeline
+ *
+ * Return: true  - no more job can be submitted
+ *         false - job can be submitted
+ */
+bool pipeline_full(const struct pipeline *pl)
+{
+	return pl->count == pl->depth;
+}
+
+/**
+ * pipeline_count - get count of jobs in flight
+ * @pl: pipeline
+ *
+ * Return: count of jobs submitted but not yet returned
+ */
+size_t pipeline_count(const struct pipeline *pl)
+{
+	return pl->count;
+}
+
+/**
+ * pipeline_submit - Submit job to workers
+ * @pl:  pipeline
+ * @job: job data
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int pipeline_submit(struct pipeline *pl, void *job)
+{
+	struct pipeline_slot *slot;
+
+	if (pipeline_full(pl))
+		return PIPELINE_FULL_FAILURE;
+
+	pthread_mutex_lock(&pl->lock);
+	slot = &pl->ring[(pl->head + pl->count) % pl->depth];
+	slot->job = job;
+	slot->ready = false;
+	pl->count++;
+	pthread_cond_signal(&pl->work);
+	pthread_mutex_unlock(&pl->lock);
+	return 0;
+}
+
+/**
+ * pipeline_next - Wait for the oldest job, and take it out of pipeline
+ * @pl: pipeline
+ *
+ * Return: job data, NULL if no job in flight
+ */
+void *pipeline_next(struct pipeline *pl)
+{
+	struct pipeline_slot *slot;
+	void *job;
+
+	if (!pl->count)
+		return NULL;
+
+	pthread_mutex_lock(&pl->lock);
+	slot = &pl->ring[pl->head];
+	while (!slot->ready)
+		pthread_cond_wait(&pl->done, &pl->lock);
+
+	job = slot->job;
+	pl->head = (pl->head + 1) % pl->depth;
+	pl->taken--;
+	pl->count--;
+	pthread_mutex_unlock(&pl->lock);
+	return job;
+}
+
+/**
+ * clean_pipeline - stop workers and clean up pipeline
+ * @pl: pipeline
+ *
+ * WARN: jobs still in flight are waited for, but not released.
+ */
+void clean_pipeline(struct pipeline *pl)
+{
+	size_t i;
+
+	while (pl->count)
+		pipeline_next(pl);
+
+	pthread_mutex_lock(&pl->lock);
+	pl->stop = true;
+	pthread_cond_broadcast(&pl->work);
+	pthread_mutex_unlock(&pl->lock);
+
+	for (i = 0; i < pl->nthreads; i++)
+		pthread_join(pl->threads[i], NULL);
+
+	pthread_cond_destroy(&pl->done);
+	pthread_cond_destroy(&pl->work);
+	pthread_mutex_destroy(&pl->lock);
+	free(pl->threads);
+	free(pl->ring);
+	free(pl);
+}
@@ -0,0 +1,16 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <stdbool.h>
+
+struct pipeline;
+
+/* pipeline.c */
+extern struct pipeline *init_pipeline(size_t, void (*)(void *));
+extern bool pipeline_full(const struct pipeline *);
+extern size_t pipeline_count(const struct pipeline *);
+extern int pipeline_submit(struct pipeline *, void *);
+extern void *pipeline_next(struct pipeline *);
+extern void clean_pipeline(struct pipeline *);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * @file psort.c
+ * @brief Parallel merge sort of pointer arrays
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ *   psort(base, count, compare);
+ *
+ * Arrays shorter than PSORT_THRESHOLD (or on a single CPU) are sorted
+ * by qsort(). Otherwise the array is split in halves recursively, one
+ * thread per half, until there are as many parts as online CPUs. Parts
+ * are sorted by qsort(), and merged back by parallel merges, which
+ * split each merge at the median of the longer input.
+ *
+ * `compare` must be a total order (no two distinct elements compare
+ * equal), then the result is the unique sorted order, identical to the
+ * one of qsort().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "psort.h"
+
+/**
+ * Merges shorter than this are not split anymore
+ */
+#define PSORT_MERGE_MIN	8192
+
+/**
+ * struct psort_args - Arguments of a sort or merge run by a thread.
+ * @base:  array to be sorted (sort)
+ * @tmp:   scratch array of `n` elements (sort)
+ * @n:     count of `base` (sort)
+ * @a:     sorted input (merge)
+ * @na:    count of `a` (merge)
+ * @b:     sorted input (merge)
+ * @nb:    count of `b` (merge)
+ * @dest:  output of `na + nb` elements (merge)
+ * @cmp:   comparator
+ * @depth: how many more times the work may be split into threads
+ */
+struct psort_args {
+	void **base;
+	void **tmp;
+	size_t n;
+	void **a;
+	size_t na;
+	void **b;
+	size_t nb;
+	void **dest;
+	int (*cmp)(const void *, const void *);
+	int depth;
+};
+
+/**
+ * spawn - Run `fn(arg)` in a new thread
+ * @th:  Output. thread
+ * @fn:  thread routine
+ * @arg: argument of `fn`
+ *
+ * If a thread cannot be created, `fn(arg)` is run by the caller.
+ *
+ * Return: true  - thread is started (must be joined)
+ *         false - `fn(arg)` is already finished
+ */
+static bool spawn(pthread_t *th, void *(*fn)(void *), void *arg)
+{
+	if (!pthread_create(th, NULL, fn, arg))
+		return true;
+	fn(arg);
+	return false;
+}
+
+/**
+ * lower_bound - Find the first element not less than key
+ * @a:   sorted array
+ * @n:   count of `a`
+ * @key: element pointer
+ * @cmp: comparator
+ *
+ * Return: index of the first element of `a` not less than `key`
+ */
+static size_t lower_bound(void **a, size_t n, void **key,
+			int (*cmp)(const void *, const void *))
+{
+	size_t lo = 0, hi = n;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (cmp(&a[mid], key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * merge - Merge two sorted arrays
+ * @p: merge arguments
+ */
+static void merge(const struct psort_args *p)
+{
+	void **a = p->a, **ae = p->a + p->na;
+	void **b = p->b, **be = p->b + p->nb;
+	void **dest = p->dest;
+
+	while (a < ae && b < be)
+		*dest++ = (p->cmp(b, a) < 0) ? *b++ : *a++;
+	memcpy(dest, a, (ae - a) * sizeof(*a));
+	dest += ae - a;
+	memcpy(dest, b, (be - b) * sizeof(*b));
+}
+
+/**
+ * pmerge - Merge two sorted arrays, in parallel (thread routine)
+ * @arg: merge arguments (struct psort_args)
+ *
+ * The median of the longer input is put to its final position, and
+ * the elements before and after it are merged independently.
+ *
+ * Return: NULL
+ */
+static void *pmerge(void *arg)
+{
+	struct psort_args *p = arg;
+	struct psort_args lo, hi;
+	pthread_t th;
+	size_t ma, mb;
+
+	if (!p->depth || p->na + p->nb < PSORT_MERGE_MIN) {
+		merge(p);
+		return NULL;
+	}
+
+	lo = *p;
+	if (lo.na < lo.nb) {
+		lo.a = p->b;
+		lo.na = p->nb;
+		lo.b = p->a;
+		lo.nb = p->na;
+	}
+	ma = lo.na / 2;
+	mb = lower_bound(lo.b, lo.nb, &lo.a[ma], lo.cmp);
+	lo.dest[ma + mb] = lo.a[ma];
+
+	hi = lo;
+	hi.a += ma + 1;
+	hi.na -= ma + 1;
+	hi.b += mb;
+	hi.nb -= mb;
+	hi.dest += ma + mb + 1;
+	lo.na = ma;
+	lo.nb = mb;
+	lo.depth = hi.depth = p->depth - 1;
+
+	if (spawn(&th, pmerge, &lo)) {
+		pmerge(&hi);
+		pthread_join(th, NULL);
+	} else {
+		pmerge(&hi);
+	}
+	return NULL;
+}
+
+/**
+ * psort_rec - Sort array, in parallel (thread routine)
+ * @arg: sort arguments (struct psort_args)
+ *
+ * Return: NULL
+ */
+static void *psort_rec(void *arg)
+{
+	struct psort_args *p = arg;
+	struct psort_args lo, hi, m;
+	pthread_t th;
+	size_t half = p->n / 2;
+
+	if (!p->depth || p->n < PSORT_MERGE_MIN) {
+		qsort(p->base, p->n, sizeof(*p->base), p->cmp);
+		return NULL;
+	}
+
+	lo = hi = *p;
+	lo.n = half;
+	hi.base += half;
+	hi.tmp += half;
+	hi.n -= half;
+	lo.depth = hi.depth = p->depth - 1;
+
+	if (spawn(&th, psort_rec, &lo)) {
+		psort_rec(&hi);
+		pthread_join(th, NULL);
+	} else {
+		psort_rec(&hi);
+	}
+
+	m = *p;
+	m.a = p->base;
+	m.na = half;
+	m.b = p->base + half;
+	m.nb = p->n - half;
+	m.dest = p->tmp;
+	pmerge(&m);
+	memcpy(p->base, p->tmp, p->n * sizeof(*p->base));
+	return NULL;
+}
+
+/**
+ * psort - Sort array of pointers, in parallel if it is large
+ * @base: array of pointers
+ * @n:    count of `base`
+ * @cmp:  comparator of `void **` (total order)
+ */
+void psort(void **base, size_t n, int (*cmp)(const void *, const void *))
+{
+	struct psort_args p;
+	long cpus = 1;
+	int depth = 0;
+
+	if (n >= PSORT_THRESHOLD)
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus > PSORT_MAX_THREADS)
+		cpus = PSORT_MAX_THREADS;
+	while ((1L << depth) < cpus)
+		depth++;
+
+	memset(&p, '\0', sizeof(p));
+	if (depth)
+		p.tmp = malloc(n * sizeof(*base));
+	if (!p.tmp) {
+		qsort(base, n, sizeof(*base), cmp);
+		return;
+	}
+
+	p.base = base;
+	p.n = n;
+	p.cmp = cmp;
+	p.depth = depth;
+	psort_rec(&p);
+	free(p.tmp);
+}
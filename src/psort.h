@@ -0,0 +1,18 @@
+#ifndef _PSORT_H
+#define _PSORT_H
+
+/**
+ * Arrays of this count or more are sorted by multiple threads.
+ * Each thread sorts at least about PSORT_THRESHOLD / PSORT_MAX_THREADS.
+ */
+#define PSORT_THRESHOLD		(256 * 1024)
+
+/**
+ * Maximum count of threads sorting an array
+ */
+#define PSORT_MAX_THREADS	16
+
+/* psort.c */
+extern void psort(void **, size_t, int (*)(const void *, const void *));
+
+#endif
@@ -0,0 +1,416 @@
+/**
+ * @file quote.c
+ * @brief Quoting of file names (control characters and shell syntax)
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. style = quoting_style_of("shell-escape");
+ * 2. init_quote(style, hide_control);
+ * 3. len = quote_name(out, name); (out is NULL to count only)
+ *
+ * Nearly all file names have nothing to be quoted. Such names are found
+ * by a scan of eight bytes at a time, and written as they are. Only the
+ * other names are quoted a character at a time, where characters which
+ * are not printable in the locale (LC_CTYPE) are escaped or hidden.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <locale.h>
+#include <wchar.h>
+#include <wctype.h>
+#include "quote.h"
+
+/**
+ * Word of the same byte
+ */
+#define BYTES(c)	(0x0101010101010101ULL * (uint8_t)(c))
+#define HIGH_BITS	BYTES(0x80)
+
+/**
+ * Characters which shell would interpret
+ */
+#define SHELL_SPECIALS	" \t\n!\"#$&'()*;<>?[\\]^`{|}~"
+
+/**
+ * struct byte_range - Printable ASCII bytes which are quoted.
+ * @lo: first byte (0x20 or later), 0 terminates ranges
+ * @hi: last byte (0x7e or earlier)
+ */
+struct byte_range {
+	unsigned char lo;
+	unsigned char hi;
+};
+
+/*
+ * bytes which may be quoted, by quoting style. A superset is enough:
+ * a name having one of them is checked a character at a time.
+ */
+static const struct byte_range specials[][6] =
+{
+	[QUOTE_LITERAL] = {{0, 0}},
+	[QUOTE_SHELL] = {
+		{' ', '*'}, {';', '?'}, {'[', '^'}, {'`', '`'}, {'{', '~'},
+		{0, 0}
+	},
+	[QUOTE_SHELL_ALWAYS] = {{'\'', '\''}, {0, 0}},
+	[QUOTE_SHELL_ESCAPE] = {
+		{' ', '*'}, {';', '?'}, {'[', '^'}, {'`', '`'}, {'{', '~'},
+		{0, 0}
+	},
+	[QUOTE_SHELL_ESCAPE_ALWAYS] = {{'\'', '\''}, {0, 0}},
+	[QUOTE_C] = {{'"', '"'}, {'\\', '\\'}, {0, 0}},
+	[QUOTE_ESCAPE] = {{' ', ' '}, {'\\', '\\'}, {0, 0}}
+};
+
+/* names of quoting styles ('--quoting-style') */
+static const char *const style_names[] =
+{
+	[QUOTE_LITERAL] = "literal",
+	[QUOTE_SHELL] = "shell",
+	[QUOTE_SHELL_ALWAYS] = "shell-always",
+	[QUOTE_SHELL_ESCAPE] = "shell-escape",
+	[QUOTE_SHELL_ESCAPE_ALWAYS] = "shell-escape-always",
+	[QUOTE_C] = "c",
+	[QUOTE_ESCAPE] = "escape"
+};
+
+static enum quoting_style style;
+/* unprintable characters are shown as '?' (if not escaped) */
+static bool hide;
+
+/**
+ * quoting_style_of - Look up quoting style by name
+ * @name: name of style
+ *
+ * Return: quoting style
+ *         -1 - unknown name
+ */
+int quoting_style_of(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(style_names) / sizeof(style_names[0]); i++)
+		if (!strcmp(name, style_names[i]))
+			return i;
+	return -1;
+}
+
+/**
+ * init_quote - Set how file names are quoted
+ * @quoting:      quoting style
+ * @hide_control: show unprintable characters as '?' (if not escaped)
+ *
+ * The character set of the locale is loaded if names are quoted.
+ * setlocale() is not thread-safe: call this before starting threads.
+ */
+void init_quote(enum quoting_style quoting, bool hide_control)
+{
+	style = quoting;
+	hide = hide_control;
+	if (style != QUOTE_LITERAL || hide)
+		setlocale(LC_CTYPE, "");
+}
+
+/**
+ * dirty_bytes - Find bytes which may be quoted in a word
+ * @x: eight bytes of name
+ *
+ * Each byte is tested in its own lane: the high bits are cleared first,
+ * so that no addition carries into the next byte.
+ *
+ * Return: high bit set for each byte which may be quoted
+ *         (a lane may be set wrongly, only in a word having such a byte)
+ */
+static inline uint64_t dirty_bytes(uint64_t x)
+{
+	const struct byte_range *r;
+	uint64_t low = x & ~HIGH_BITS;
+	uint64_t dirty = x & HIGH_BITS;			/* not ASCII */
+
+	dirty |= ~(low + BYTES(0x80 - 0x20)) & HIGH_BITS;	/* control */
+	dirty |= (low + BYTES(0x01)) & HIGH_BITS;		/* DEL */
+	for (r = specials[style]; r->lo; r++)
+		dirty |= (low + BYTES(0x80 - r->lo)) &
+				~(low + BYTES(0x7f - r->hi)) & HIGH_BITS;
+	return dirty;
+}
+
+/**
+ * name_is_clean - Check that name has nothing to be quoted
+ * @name: file name
+ * @len:  length of `name`
+ *
+ * Return: true if `name` can be written as it is (in quotes of style)
+ */
+static bool name_is_clean(const char *name, size_t len)
+{
+	uint64_t x;
+
+	for (; len >= sizeof(x); name += sizeof(x), len -= sizeof(x)) {
+		memcpy(&x, name, sizeof(x));
+		if (dirty_bytes(x))
+			return false;
+	}
+	if (len) {
+		/* padded by a byte which is never quoted */
+		x = BYTES('A');
+		memcpy(&x, name, len);
+		if (dirty_bytes(x))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * put - Write bytes
+ * @out: Output stream (NULL to count only)
+ * @s:   bytes
+ * @n:   count of `s`
+ *
+ * Return: n
+ */
+static size_t put(FILE *out, const char *s, size_t n)
+{
+	if (out != NULL)
+		fwrite(s, sizeof(char), n, out);
+	return n;
+}
+
+/**
+ * put_escape - Write C escape of byte (\n, \ooo, ...)
+ * @out: Output stream (NULL to count only)
+ * @c:   byte
+ *
+ * Return: count of bytes written
+ */
+static size_t put_escape(FILE *out, unsigned char c)
+{
+	static const char controls[] = "\a\b\f\n\r\t\v";
+	static const char letters[] = "abfnrtv";
+	const char *p = c ? strchr(controls, c) : NULL;
+	char buf[5];
+
+	if (p) {
+		buf[0] = '\\';
+		buf[1] = letters[p - controls];
+		return put(out, buf, 2);
+	}
+	snprintf(buf, sizeof(buf), "\\%03o", c);
+	return put(out, buf, 4);
+}
+
+/**
+ * next_char - Length of the character at the beginning of name
+ * @p:         rest of name
+ * @left:      length of `p`
+ * @printable: Output. the character is printable
+ *
+ * A byte which does not start a valid character is a character.
+ *
+ * Return: length of the character
+ */
+static size_t next_char(const char *p, size_t left, bool *printable)
+{
+	unsigned char c = *p;
+	mbstate_t state;
+	wchar_t wc;
+	size_t n;
+
+	if (c < 0x80) {
+		*printable = (c >= 0x20 && c < 0x7f);
+		return 1;
+	}
+	memset(&state, '\0', sizeof(state));
+	n = mbrtowc(&wc, p, left, &state);
+	if (n == (size_t)-1 || n == (size_t)-2 || n == 0) {
+		*printable = false;
+		return 1;
+	}
+	*printable = iswprint(wc);
+	return n;
+}
+
+/**
+ * shell_needs_quote - Check that shell would interpret name
+ * @name: file name
+ * @len:  length of `name`
+ *
+ * Return: true if `name` has shell specials or unprintable characters
+ */
+static bool shell_needs_quote(const char *name, size_t len)
+{
+	bool printable;
+	size_t i, n;
+
+	for (i = 0; i < len; i += n) {
+		n = next_char(name + i, len - i, &printable);
+		if (!printable || strchr(SHELL_SPECIALS, name[i]))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * quote_c - Write name with C escapes ("c", "escape")
+ * @out:  Output stream (NULL to count only)
+ * @name: file name
+ * @len:  length of `name`
+ *
+ * Return: count of bytes written
+ */
+static size_t quote_c(FILE *out, const char *name, size_t len)
+{
+	bool printable;
+	size_t count = 0;
+	size_t i, k, n;
+
+	if (style == QUOTE_C)
+		count += put(out, "\"", 1);
+	for (i = 0; i < len; i += n) {
+		n = next_char(name + i, len - i, &printable);
+		if (!printable) {
+			for (k = 0; k < n; k++)
+				count += put_escape(out, name[i + k]);
+			continue;
+		}
+		if (name[i] == '\\' ||
+				(style == QUOTE_C && name[i] == '"') ||
+				(style == QUOTE_ESCAPE && name[i] == ' '))
+			count += put(out, "\\", 1);
+		count += put(out, name + i, n);
+	}
+	if (style == QUOTE_C)
+		count += put(out, "\"", 1);
+	return count;
+}
+
+/**
+ * quote_shell - Write name in '...' ("literal", "shell", "shell-always")
+ * @out:  Output stream (NULL to count only)
+ * @name: file name
+ * @len:  length of `name`
+ *
+ * Unprintable characters are written as they are, or '?' if hidden.
+ *
+ * Return: count of bytes written
+ */
+static size_t quote_shell(FILE *out, const char *name, size_t len)
+{
+	bool printable, quote;
+	size_t count = 0;
+	size_t i, n;
+
+	quote = style == QUOTE_SHELL_ALWAYS ||
+		(style == QUOTE_SHELL && shell_needs_quote(name, len));
+	if (quote)
+		count += put(out, "'", 1);
+	for (i = 0; i < len; i += n) {
+		n = next_char(name + i, len - i, &printable);
+		if (!printable && hide)
+			count += put(out, "?", 1);
+		else if (quote && name[i] == '\'')
+			count += put(out, "'\\''", 4);
+		else
+			count += put(out, name + i, n);
+	}
+	if (quote)
+		count += put(out, "'", 1);
+	return count;
+}
+
+/**
+ * quote_shell_escape - Write name in '...' and $'...' ("shell-escape")
+ * @out:  Output stream (NULL to count only)
+ * @name: file name
+ * @len:  length of `name`
+ *
+ * Printable characters are quoted in '...', and the others are escaped
+ * in $'...', so that shell reads back the same name.
+ *
+ * Return: count of bytes written
+ */
+static size_t quote_shell_escape(FILE *out, const char *name, size_t len)
+{
+	enum { NONE, QUOTED, ESCAPED } state = NONE;
+	bool printable;
+	size_t count = 0;
+	size_t i, k, n;
+
+	if (style == QUOTE_SHELL_ESCAPE && !shell_needs_quote(name, len))
+		return put(out, name, len);
+
+	for (i = 0; i < len; i += n) {
+		n = next_char(name + i, len - i, &printable);
+		if (printable) {
+			if (state == ESCAPED)
+				count += put(out, "'", 1);
+			if (state != QUOTED)
+				count += put(out, "'", 1);
+			state = QUOTED;
+			if (name[i] == '\'')
+				count += put(out, "'\\''", 4);
+			else
+				count += put(out, name + i, n);
+		} else {
+			if (state == QUOTED)
+				count += put(out, "'", 1);
+			if (state != ESCAPED)
+				count += put(out, "$'", 2);
+			state = ESCAPED;
+			for (k = 0; k < n; k++)
+				count += put_escape(out, name[i + k]);
+		}
+	}
+	if (state != NONE)
+		count += put(out, "'", 1);
+	return count;
+}
+
+/**
+ * quote_name - Write file name, quoted by style
+ * @out:  Output stream (NULL to count only)
+ * @name: file name
+ *
+ * Return: count of bytes written
+ */
+size_t quote_name(FILE *out, const char *name)
+{
+	size_t len = strlen(name);
+	size_t count = 0;
+
+	if (style == QUOTE_LITERAL && !hide)
+		return put(out, name, len);
+
+	if (name_is_clean(name, len)) {
+		switch (style) {
+		case QUOTE_SHELL_ALWAYS:
+		case QUOTE_SHELL_ESCAPE_ALWAYS:
+			count += put(out, "'", 1);
+			count += put(out, name, len);
+			count += put(out, "'", 1);
+			return count;
+		case QUOTE_C:
+			count += put(out, "\"", 1);
+			count += put(out, name, len);
+			count += put(out, "\"", 1);
+			return count;
+		default:
+			return put(out, name, len);
+		}
+	}
+
+	switch (style) {
+	case QUOTE_C:
+	case QUOTE_ESCAPE:
+		return quote_c(out, name, len);
+	case QUOTE_SHELL_ESCAPE:
+	case QUOTE_SHELL_ESCAPE_ALWAYS:
+		return quote_shell_escape(out, name, len);
+	default:
+		return quote_shell(out, name, len);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef _QUOTE_H
+#define _QUOTE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**
+ * enum quoting_style - How file names are quoted.
+ * @QUOTE_LITERAL:             as it is
+ * @QUOTE_SHELL:               '...' if shell would interpret the name
+ * @QUOTE_SHELL_ALWAYS:        always '...'
+ * @QUOTE_SHELL_ESCAPE:        like QUOTE_SHELL, unprintable as $'\ooo'
+ * @QUOTE_SHELL_ESCAPE_ALWAYS: like QUOTE_SHELL_ALWAYS, unprintable as $'\ooo'
+ * @QUOTE_C:                   "..." with C escapes
+ * @QUOTE_ESCAPE:              C escapes (and '\ ') without quotes
+ */
+enum quoting_style {
+	QUOTE_LITERAL,
+	QUOTE_SHELL,
+	QUOTE_SHELL_ALWAYS,
+	QUOTE_SHELL_ESCAPE,
+	QUOTE_SHELL_ESCAPE_ALWAYS,
+	QUOTE_C,
+	QUOTE_ESCAPE
+};
+
+/* quote.c */
+extern int quoting_style_of(const char *);
+extern void init_quote(enum quoting_style, bool);
+extern size_t quote_name(FILE *, const char *);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file ratelimit.c
+ * @brief Token bucket pacing metadata system calls ('--max-iops')
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_ratelimit(rate, burst, count); (rate 0 does not pace calls)
+ * 2. ratelimit_take(n); (before n system calls, from any thread)
+ * 3. ratelimit_calls(), ratelimit_throttled(); (for '--stats')
+ *
+ * The bucket holds at most `burst` tokens, and is refilled by `rate`
+ * tokens per second. A call takes a token, or reserves the next one:
+ * the count of tokens goes below zero, and the caller sleeps until its
+ * token is refilled. So that concurrent callers are served in order of
+ * arrival, and the rate holds however many threads make calls.
+ *
+ * Without rate, no lock is taken: calls are only counted (atomically) if
+ * requested, or not at all.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ratelimit.h"
+
+static unsigned long rate;
+static bool counting;
+static double burst;
+/* tokens in bucket (negative if reserved), as of `refilled` */
+static double tokens;
+static uint64_t refilled;
+/* statistics for '--stats' (`calls` is updated atomically) */
+static uint64_t calls;
+static uint64_t throttled;
+/* protects all of the above, except `calls` */
+static pthread_mutex_t ratelimit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * now_ns - Monotonic time
+ *
+ * Return: nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * init_ratelimit - Start pacing (or counting) calls
+ * @calls_per_sec: rate of calls, 0 means unlimited
+ * @burst_calls:   calls which may be made at once (at least 1)
+ * @count:         count calls, even if unlimited
+ *
+ * Called before any thread takes tokens.
+ */
+void init_ratelimit(unsigned long calls_per_sec, unsigned long burst_calls,
+								bool count)
+{
+	pthread_mutex_lock(&ratelimit_lock);
+	rate = calls_per_sec;
+	counting = count || calls_per_sec;
+	burst = burst_calls ? burst_calls : 1;
+	tokens = burst;
+	refilled = now_ns();
+	__atomic_store_n(&calls, 0, __ATOMIC_RELAXED);
+	throttled = 0;
+	pthread_mutex_unlock(&ratelimit_lock);
+}
+
+/**
+ * ratelimit_take - Wait until calls are allowed
+ * @n: count of system calls to be made
+ */
+void ratelimit_take(unsigned int n)
+{
+	struct timespec ts;
+	uint64_t now, wait = 0;
+
+	if (!counting)
+		return;
+	__atomic_fetch_add(&calls, n, __ATOMIC_RELAXED);
+	if (!rate)
+		return;
+
+	pthread_mutex_lock(&ratelimit_lock);
+	now = now_ns();
+	tokens += (double)(now - refilled) * rate / 1e9;
+	if (tokens > burst)
+		tokens = burst;
+	refilled = now;
+	tokens -= n;
+	if (tokens < 0) {
+		wait = -tokens * 1e9 / rate;
+		throttled += wait;
+	}
+	pthread_mutex_unlock(&ratelimit_lock);
+
+	if (!wait)
+		return;
+	ts.tv_sec = wait / 1000000000;
+	ts.tv_nsec = wait % 1000000000;
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+
+/**
+ * ratelimit_calls - Count of calls
+ *
+ * Return: count of calls taken since init_ratelimit() (0 if not counted)
+ */
+uint64_t ratelimit_calls(void)
+{
+	return __atomic_load_n(&calls, __ATOMIC_RELAXED);
+}
+
+/**
+ * ratelimit_throttled - Time spent waiting for tokens
+ *
+ * Concurrent waits are summed up, so that this may exceed elapsed time.
+ *
+ * Return: nanoseconds
+ */
+uint64_t ratelimit_throttled(void)
+{
+	uint64_t ret;
+
+	pthread_mutex_lock(&ratelimit_lock);
+	ret = throttled;
+	pthread_mutex_unlock(&ratelimit_lock);
+	return ret;
+}
@@ -0,0 +1,13 @@
+#ifndef _RATELIMIT_H
+#define _RATELIMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ratelimit.c */
+extern void init_ratelimit(unsigned long, unsigned long, bool);
+extern void ratelimit_take(unsigned int);
+extern uint64_t ratelimit_calls(void);
+extern uint64_t ratelimit_throttled(void);
+
+#endif
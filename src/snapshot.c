@@ -0,0 +1,547 @@
+/**
+ * @file snapshot.c
+ * @brief Snapshot of listings, saved to and read back from a file
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE (save)
+ * 1. snap = snapshot_create(path, sort);
+ * 2. snapshot_begin(snap, dirname);
+ * 3. snapshot_write(snap, sorted[i]); (for each entry, in sorted order)
+ * 4. snapshot_end(snap); (back to 2. for next directory)
+ * 5. snapshot_commit(snap);
+ *
+ * HOW TO USE (diff)
+ * 1. snap = snapshot_open(path, sort); (NULL if saved in another order)
+ * 2. snapshot_seek(snap, dirname);
+ * 3. while (!snapshot_read(snap, &f)) (merge with current listing)
+ * 4. snapshot_close(snap);
+ *
+ * A snapshot is a header followed by one section per listing. A section
+ * is the directory name, and the entries in the order of the listing, so
+ * that it can be compared with a fresh listing by a single linear merge.
+ * Fields are in native byte order; the header rejects a snapshot of other
+ * byte order or layout, and of other sort order (the merge needs both
+ * listings in the same order).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "pdir.h"
+#include "snapshot.h"
+
+/**
+ * Snapshot identifier, and format version
+ */
+#define SNAPSHOT_MAGIC		"PDIRSNAP"
+#define SNAPSHOT_VERSION	2
+#define SNAPSHOT_BYTEORDER	0x01020304
+
+/**
+ * struct snapshot_header - Header of snapshot file.
+ * @magic:     SNAPSHOT_MAGIC
+ * @version:   SNAPSHOT_VERSION
+ * @byteorder: SNAPSHOT_BYTEORDER, in the byte order of writer
+ * @sort:      sort order of entries (SNAPSHOT_SORT_*)
+ */
+struct snapshot_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t sort;
+};
+
+/**
+ * struct snapshot_section - Header of a listing in snapshot.
+ * @length:  bytes of entries following the directory name
+ * @namelen: length of directory name (without '\0')
+ * @count:   count of entries
+ */
+struct snapshot_section {
+	uint64_t length;
+	uint32_t namelen;
+	uint32_t count;
+};
+
+/**
+ * struct snapshot_entry - Header of an entry in snapshot.
+ * @ino:     inode number
+ * @size:    file size
+ * @atime:   access time (sec)
+ * @mtime:   modify time (sec)
+ * @ctime:   change time (sec)
+ * @atime_nsec: access time (nsec)
+ * @mtime_nsec: modify time (nsec)
+ * @ctime_nsec: change time (nsec)
+ * @mode:    file mode, 0 if status is unknown
+ * @nlink:   link count
+ * @uid:     user-id
+ * @gid:     group-id
+ * @namelen: length of file name (without '\0')
+ * @linklen: length of symbolic link target + 1, 0 if no target
+ *
+ * File name, and symbolic link target follow the header.
+ * Only the fields shown or compared are kept (72 bytes, no padding).
+ */
+struct snapshot_entry {
+	uint64_t ino;
+	uint64_t size;
+	int64_t atime;
+	int64_t mtime;
+	int64_t ctime;
+	uint32_t atime_nsec;
+	uint32_t mtime_nsec;
+	uint32_t ctime_nsec;
+	uint32_t mode;
+	uint32_t nlink;
+	uint32_t uid;
+	uint32_t gid;
+	uint16_t namelen;
+	uint16_t linklen;
+};
+
+/**
+ * struct snapshot_index - Location of a section.
+ * @name:   directory name
+ * @offset: file offset of first entry
+ * @count:  count of entries
+ */
+struct snapshot_index {
+	char *name;
+	long offset;
+	uint32_t count;
+};
+
+/**
+ * struct snapshot - Snapshot file being written or read.
+ * @fp:       snapshot file
+ * @path:     snapshot file name (written: temporary file name)
+ * @dest:     snapshot file name to be committed (written only)
+ * @section:  file offset of current section header (written only)
+ * @current:  header of current section
+ * @index:    sections sorted by name (read only)
+ * @nindex:   count of `index`
+ * @left:     count of entries not yet read in current section
+ * @failed:   an error has occurred in writing
+ */
+struct snapshot {
+	FILE *fp;
+	char *path;
+	char *dest;
+	long section;
+	struct snapshot_section current;
+	struct snapshot_index *index;
+	size_t nindex;
+	uint32_t left;
+	bool failed;
+};
+
+/**
+ * snapshot_create - Create snapshot file to be written
+ * @path: snapshot file name
+ * @sort: sort order of entries (SNAPSHOT_SORT_*)
+ *
+ * The snapshot is written in a temporary file next to `path`, and
+ * renamed to `path` by snapshot_commit(). So that `path` may be the
+ * snapshot read by snapshot_open() at the same time, and an incomplete
+ * snapshot never replaces a complete one.
+ *
+ * Return: snapshot, or NULL when it cannot be created
+ */
+struct snapshot *snapshot_create(const char *path, unsigned int sort)
+{
+	struct snapshot_header header;
+	struct snapshot *snap;
+	mode_t mask;
+	int fd;
+
+	snap = calloc(1, sizeof(*snap));
+	if (!snap)
+		return NULL;
+	snap->dest = strdup(path);
+	snap->path = malloc(strlen(path) + sizeof("-XXXXXX"));
+	if (!snap->dest || !snap->path)
+		goto err;
+	sprintf(snap->path, "%s-XXXXXX", path);
+
+	fd = mkstemp(snap->path);
+	if (fd < 0)
+		goto err;
+	/* mode of a file created by open(), instead of 0600 of mkstemp() */
+	mask = umask(0);
+	umask(mask);
+	if (fchmod(fd, 0666 & ~mask) || !(snap->fp = fdopen(fd, "w"))) {
+		close(fd);
+		unlink(snap->path);
+		goto err;
+	}
+
+	memset(&header, '\0', sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byteorder = SNAPSHOT_BYTEORDER;
+	header.sort = sort;
+	if (fwrite(&header, sizeof(header), 1, snap->fp) != 1)
+		snap->failed = true;
+	return snap;
+
+err:
+	free(snap->path);
+	free(snap->dest);
+	free(snap);
+	return NULL;
+}
+
+/**
+ * snapshot_begin - Start a section of listing
+ * @snap:    snapshot (written)
+ * @dirname: directory name ("" for command line arguments)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_begin(struct snapshot *snap, const char *dirname)
+{
+	memset(&snap->current, '\0', sizeof(snap->current));
+	snap->current.namelen = strlen(dirname);
+	snap->section = ftell(snap->fp);
+
+	/* `length` and `count` are filled in by snapshot_end() */
+	if (snap->section < 0 ||
+		fwrite(&snap->current, sizeof(snap->current), 1, snap->fp) != 1 ||
+		fwrite(dirname, 1, snap->current.namelen, snap->fp) !=
+							snap->current.namelen)
+		snap->failed = true;
+	return snap->failed ? SNAPSHOT_FAILURE : 0;
+}
+
+/**
+ * snapshot_write - Append a File information to current section
+ * @snap: snapshot (written)
+ * @f:    File information
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_write(struct snapshot *snap, const struct fileinfo *f)
+{
+	struct snapshot_entry ent;
+	size_t namelen = strlen(f->name);
+	size_t linklen = f->linkname ? strlen(f->linkname) + 1 : 0;
+
+	if (snap->failed || namelen > UINT16_MAX || linklen > UINT16_MAX)
+		goto err;
+
+	memset(&ent, '\0', sizeof(ent));
+	if (!f->unknown) {
+		ent.ino = f->status.st_ino;
+		ent.size = f->status.st_size;
+		ent.atime = f->status.st_atim.tv_sec;
+		ent.mtime = f->status.st_mtim.tv_sec;
+		ent.ctime = f->status.st_ctim.tv_sec;
+		ent.atime_nsec = f->status.st_atim.tv_nsec;
+		ent.mtime_nsec = f->status.st_mtim.tv_nsec;
+		ent.ctime_nsec = f->status.st_ctim.tv_nsec;
+		ent.mode = f->status.st_mode;
+		ent.nlink = f->status.st_nlink;
+		ent.uid = f->status.st_uid;
+		ent.gid = f->status.st_gid;
+	}
+	ent.namelen = namelen;
+	ent.linklen = linklen;
+
+	if (fwrite(&ent, sizeof(ent), 1, snap->fp) != 1 ||
+			fwrite(f->name, 1, namelen, snap->fp) != namelen ||
+			fwrite(f->linkname, 1, linklen, snap->fp) != linklen)
+		goto err;
+
+	snap->current.length += sizeof(ent) + namelen + linklen;
+	snap->current.count++;
+	return 0;
+
+err:
+	snap->failed = true;
+	return SNAPSHOT_FAILURE;
+}
+
+/**
+ * snapshot_end - Finish current section
+ * @snap: snapshot (written)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_end(struct snapshot *snap)
+{
+	if (snap->failed ||
+		fseek(snap->fp, snap->section, SEEK_SET) ||
+		fwrite(&snap->current, sizeof(snap->current), 1, snap->fp) != 1 ||
+		fseek(snap->fp, 0, SEEK_END))
+		snap->failed = true;
+	return snap->failed ? SNAPSHOT_FAILURE : 0;
+}
+
+/**
+ * snapshot_commit - Replace snapshot file by the written one
+ * @snap: snapshot (written). released
+ *
+ * If any error has occurred in writing, the snapshot is discarded
+ * and the previous snapshot file (if any) is kept.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_commit(struct snapshot *snap)
+{
+	int ret = 0;
+
+	if (fclose(snap->fp) || snap->failed ||
+				rename(snap->path, snap->dest)) {
+		unlink(snap->path);
+		ret = SNAPSHOT_FAILURE;
+	}
+	snap->fp = NULL;
+	snapshot_close(snap);
+	return ret;
+}
+
+/**
+ * compare_index - Compare sections by directory name
+ * @a: snapshot_index pointer
+ * @b: snapshot_index pointer
+ *
+ * Return: result of strcmp()
+ */
+static int compare_index(const void *a, const void *b)
+{
+	return strcmp(((const struct snapshot_index *)a)->name,
+			((const struct snapshot_index *)b)->name);
+}
+
+/**
+ * read_index - Read the location of each section
+ * @snap: snapshot (read)
+ *
+ * Only section headers are read, entries are skipped by their length.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int read_index(struct snapshot *snap)
+{
+	struct snapshot_section sec;
+	size_t alloc = 0;
+
+	while (fread(&sec, sizeof(sec), 1, snap->fp) == 1) {
+		struct snapshot_index *idx;
+
+		if (snap->nindex == alloc) {
+			alloc = alloc ? alloc * 2 : ALLOCATE_COUNT;
+			idx = realloc(snap->index, alloc * sizeof(*idx));
+			if (!idx)
+				return ALLOCATION_FAILURE;
+			snap->index = idx;
+		}
+		idx = &snap->index[snap->nindex];
+		idx->name = malloc(sec.namelen + 1);
+		if (!idx->name)
+			return ALLOCATION_FAILURE;
+		if (fread(idx->name, 1, sec.namelen, snap->fp) != sec.namelen) {
+			free(idx->name);
+			return SNAPSHOT_FAILURE;
+		}
+		idx->name[sec.namelen] = '\0';
+		idx->offset = ftell(snap->fp);
+		idx->count = sec.count;
+		snap->nindex++;
+
+		if (idx->offset < 0 ||
+			fseek(snap->fp, sec.length, SEEK_CUR))
+			return SNAPSHOT_FAILURE;
+	}
+	if (ferror(snap->fp))
+		return SNAPSHOT_FAILURE;
+
+	qsort(snap->index, snap->nindex, sizeof(*snap->index), compare_index);
+	return 0;
+}
+
+/**
+ * snapshot_open - Open snapshot file to be read
+ * @path: snapshot file name
+ * @sort: sort order of current listing (SNAPSHOT_SORT_*)
+ *
+ * Return: snapshot, or NULL when it cannot be read (or is not a snapshot
+ *         of the same sort order)
+ */
+struct snapshot *snapshot_open(const char *path, unsigned int sort)
+{
+	struct snapshot_header header;
+	struct snapshot *snap;
+
+	snap = calloc(1, sizeof(*snap));
+	if (!snap)
+		return NULL;
+	snap->fp = fopen(path, "r");
+	if (!snap->fp)
+		goto err;
+
+	if (fread(&header, sizeof(header), 1, snap->fp) != 1 ||
+		memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) ||
+		header.version != SNAPSHOT_VERSION ||
+		header.byteorder != SNAPSHOT_BYTEORDER ||
+		header.sort != sort) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	if (read_index(snap)) {
+		errno = EINVAL;
+		goto err;
+	}
+	return snap;
+
+err:
+	snapshot_close(snap);
+	return NULL;
+}
+
+/**
+ * snapshot_seek - Move to the section of listing
+ * @snap:    snapshot (read)
+ * @dirname: directory name ("" for command line arguments)
+ *
+ * If the section is not in the snapshot, it is read as empty.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_seek(struct snapshot *snap, const char *dirname)
+{
+	struct snapshot_index key = { .name = (char *)dirname };
+	struct snapshot_index *idx;
+
+	snap->left = 0;
+	idx = bsearch(&key, snap->index, snap->nindex, sizeof(*snap->index),
+							compare_index);
+	if (!idx)
+		return 0;
+	if (fseek(snap->fp, idx->offset, SEEK_SET))
+		return SNAPSHOT_FAILURE;
+	snap->left = idx->count;
+	return 0;
+}
+
+/**
+ * snapshot_read - Read next File information from current section
+ * @snap: snapshot (read)
+ * @f:    output. File information (name is allocated)
+ *
+ * Return: 0 - success
+ *         -1 - end of section
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int snapshot_read(struct snapshot *snap, struct fileinfo *f)
+{
+	struct snapshot_entry ent;
+
+	if (!snap->left)
+		return -1;
+	if (fread(&ent, sizeof(ent), 1, snap->fp) != 1)
+		return SNAPSHOT_FAILURE;
+
+	memset(f, '\0', sizeof(*f));
+	f->name = malloc(ent.namelen + 1 + ent.linklen);
+	if (!f->name)
+		return ALLOCATION_FAILURE;
+	if (fread(f->name, 1, ent.namelen, snap->fp) != ent.namelen ||
+		fread(f->name + ent.namelen + 1, 1, ent.linklen, snap->fp) !=
+								ent.linklen) {
+		free(f->name);
+		f->name = NULL;
+		return SNAPSHOT_FAILURE;
+	}
+	f->name[ent.namelen] = '\0';
+	if (ent.linklen)
+		f->linkname = f->name + ent.namelen + 1;
+
+	f->status.st_ino = ent.ino;
+	f->status.st_size = ent.size;
+	f->status.st_atim.tv_sec = ent.atime;
+	f->status.st_mtim.tv_sec = ent.mtime;
+	f->status.st_ctim.tv_sec = ent.ctime;
+	f->status.st_atim.tv_nsec = ent.atime_nsec;
+	f->status.st_mtim.tv_nsec = ent.mtime_nsec;
+	f->status.st_ctim.tv_nsec = ent.ctime_nsec;
+	f->status.st_mode = ent.mode;
+	f->status.st_nlink = ent.nlink;
+	f->status.st_uid = ent.uid;
+	f->status.st_gid = ent.gid;
+	f->unknown = !ent.mode;
+	snap->left--;
+	return 0;
+}
+
+/**
+ * snapshot_changed - Check whether File information has changed
+ * @old: File information read from snapshot
+ * @new: File information of current listing (same name)
+ *
+ * Access time is not compared, since listing does not change a file.
+ * Entries whose status is unknown are never reported as changed.
+ *
+ * Link targets are compared only when both are known (long format).
+ *
+ * Return: true  - inode, type, permission, owner, link count, size,
+ *                 modify/change time or link target differs
+ *         false - otherwise
+ */
+bool snapshot_changed(const struct fileinfo *old, const struct fileinfo *new)
+{
+	const struct stat *a = &old->status;
+	const struct stat *b = &new->status;
+
+	if (old->unknown || new->unknown)
+		return false;
+
+	return a->st_ino != b->st_ino || a->st_mode != b->st_mode ||
+		a->st_uid != b->st_uid || a->st_gid != b->st_gid ||
+		a->st_nlink != b->st_nlink || a->st_size != b->st_size ||
+		a->st_mtim.tv_sec != b->st_mtim.tv_sec ||
+		a->st_mtim.tv_nsec != b->st_mtim.tv_nsec ||
+		a->st_ctim.tv_sec != b->st_ctim.tv_sec ||
+		a->st_ctim.tv_nsec != b->st_ctim.tv_nsec ||
+		(old->linkname && new->linkname &&
+				strcmp(old->linkname, new->linkname));
+}
+
+/**
+ * snapshot_close - Release snapshot
+ * @snap: snapshot
+ *
+ * A snapshot being written is discarded (see snapshot_commit()).
+ */
+void snapshot_close(struct snapshot *snap)
+{
+	size_t i;
+
+	if (!snap)
+		return;
+	if (snap->fp) {
+		fclose(snap->fp);
+		if (snap->dest)
+			unlink(snap->path);
+	}
+	for (i = 0; i < snap->nindex; i++)
+		free(snap->index[i].name);
+	free(snap->index);
+	free(snap->path);
+	free(snap->dest);
+	free(snap);
+}
@@ -0,0 +1,30 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdbool.h>
+
+struct snapshot;
+
+/**
+ * Sort order of entries in snapshot (flags)
+ * @SNAPSHOT_SORT_DIRS_FIRST: directories before other files
+ * @SNAPSHOT_SORT_VERSION:    names in version order ('-v')
+ */
+enum {
+	SNAPSHOT_SORT_DIRS_FIRST = 0x1,
+	SNAPSHOT_SORT_VERSION = 0x2
+};
+
+/* snapshot.c */
+extern struct snapshot *snapshot_create(const char *, unsigned int);
+extern int snapshot_begin(struct snapshot *, const char *);
+extern int snapshot_write(struct snapshot *, const struct fileinfo *);
+extern int snapshot_end(struct snapshot *);
+extern int snapshot_commit(struct snapshot *);
+extern struct snapshot *snapshot_open(const char *, unsigned int);
+extern int snapshot_seek(struct snapshot *, const char *);
+extern int snapshot_read(struct snapshot *, struct fileinfo *);
+extern bool snapshot_changed(const struct fileinfo *, const struct fileinfo *);
+extern void snapshot_close(struct snapshot *);
+
+#endif
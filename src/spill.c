@@ -0,0 +1,359 @@
+/**
+ * @file spill.c
+ * @brief Sorted runs of file information spilled to temporary files
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. run = spill_create();
+ * 2. spill_write(run, sorted[i]); (for each entry, in sorted order)
+ * 3. spill_merge(runs, nruns, sorted, count, compare, emit, arg);
+ *
+ * Used when the file information slots would exceed '--memory-limit'.
+ * Each run is written in the order of the slots, then all runs and the
+ * entries still in memory are k-way merged with the same comparator,
+ * so that the output is identical to the one of an in-memory sort.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "pdir.h"
+#include "spill.h"
+
+/**
+ * struct spill_record - On-disk header of a spilled entry.
+ * @namelen: length of file name (without '\0')
+ * @linklen: length of symbolic link target + 1, 0 if no target
+ * @contextlen: length of security context + 1, 0 if no context
+ * @keylen:  length of sort key + 1, 0 if no key
+ * @status:  File status
+ * @is_command_arg: specified that command_line argument
+ * @unknown: status could not be read in time
+ * @xattr:   ACL or security context indicator
+ *
+ * File name, symbolic link target, security context and sort key follow
+ * the header. Runs never outlive the process,
+ * so the native layout of `struct stat` is used.
+ */
+struct spill_record {
+	size_t namelen;
+	size_t linklen;
+	size_t contextlen;
+	size_t keylen;
+	struct stat status;
+	bool is_command_arg;
+	bool unknown;
+	char xattr;
+};
+
+/**
+ * struct spill_source - One input of k-way merge.
+ * @cur:  entry read from `fp`
+ * @ptr:  current entry (`&cur` or element of `mem`)
+ * @fp:   spilled run (NULL if source is in memory)
+ * @mem:  sorted entries in memory
+ * @left: count of entries remaining in `mem`
+ */
+struct spill_source {
+	struct fileinfo cur;
+	struct fileinfo *ptr;
+	FILE *fp;
+	struct fileinfo **mem;
+	size_t left;
+};
+
+/**
+ * spill_create - Create an anonymous temporary file for a run
+ *
+ * The file is created in $TMPDIR (default "/tmp") and unlinked at once,
+ * so it disappears when closed or when the process exits.
+ *
+ * Return: file stream, or NULL when it cannot be created
+ */
+FILE *spill_create(void)
+{
+	const char *dir = getenv("TMPDIR");
+	char *path;
+	int fd;
+	FILE *fp = NULL;
+
+	if (!dir || !*dir)
+		dir = "/tmp";
+
+	path = malloc(strlen(dir) + sizeof("/pdir-XXXXXX"));
+	if (!path)
+		return NULL;
+	sprintf(path, "%s/pdir-XXXXXX", dir);
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		goto out;
+	unlink(path);
+
+	fp = fdopen(fd, "w+");
+	if (!fp)
+		close(fd);
+out:
+	free(path);
+	return fp;
+}
+
+/**
+ * spill_write - Append a File information to run
+ * @fp: spilled run
+ * @f:  File information
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int spill_write(FILE *fp, const struct fileinfo *f)
+{
+	struct spill_record rec;
+
+	memset(&rec, '\0', sizeof(rec));
+	rec.namelen = strlen(f->name);
+	rec.linklen = f->linkname ? strlen(f->linkname) + 1 : 0;
+	rec.status = f->status;
+	rec.is_command_arg = f->is_command_arg;
+	rec.unknown = f->unknown;
+	rec.contextlen = f->context ? strlen(f->context) + 1 : 0;
+	rec.keylen = f->key ? strlen(f->key) + 1 : 0;
+	rec.xattr = f->xattr;
+
+	if (fwrite(&rec, sizeof(rec), 1, fp) != 1 ||
+			fwrite(f->name, 1, rec.namelen, fp) != rec.namelen ||
+			fwrite(f->linkname, 1, rec.linklen, fp) != rec.linklen ||
+			fwrite(f->context, 1, rec.contextlen, fp) !=
+							rec.contextlen ||
+			fwrite(f->key, 1, rec.keylen, fp) != rec.keylen)
+		return SPILL_FAILURE;
+	return 0;
+}
+
+/**
+ * spill_read - Read next File information from run
+ * @fp: spilled run
+ * @f:  output. File information (name is allocated)
+ *
+ * Return: 0 - success
+ *         -1 - end of run
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int spill_read(FILE *fp, struct fileinfo *f)
+{
+	struct spill_record rec;
+
+	if (fread(&rec, sizeof(rec), 1, fp) != 1)
+		return feof(fp) ? -1 : SPILL_FAILURE;
+
+	memset(f, '\0', sizeof(*f));
+	f->name = malloc(rec.namelen + 1 + rec.linklen + rec.contextlen +
+								rec.keylen);
+	if (!f->name)
+		return ALLOCATION_FAILURE;
+	if (fread(f->name, 1, rec.namelen, fp) != rec.namelen ||
+		fread(f->name + rec.namelen + 1, 1, rec.linklen, fp) != rec.linklen ||
+		fread(f->name + rec.namelen + 1 + rec.linklen, 1,
+				rec.contextlen, fp) != rec.contextlen ||
+		fread(f->name + rec.namelen + 1 + rec.linklen + rec.contextlen,
+				1, rec.keylen, fp) != rec.keylen) {
+		free(f->name);
+		f->name = NULL;
+		return SPILL_FAILURE;
+	}
+	f->name[rec.namelen] = '\0';
+	if (rec.linklen)
+		f->linkname = f->name + rec.namelen + 1;
+	if (rec.contextlen)
+		f->context = f->name + rec.namelen + 1 + rec.linklen;
+	if (rec.keylen)
+		f->key = f->name + rec.namelen + 1 + rec.linklen +
+							rec.contextlen;
+	f->xattr = rec.xattr;
+	f->status = rec.status;
+	f->is_command_arg = rec.is_command_arg;
+	f->unknown = rec.unknown;
+	return 0;
+}
+
+/**
+ * advance_source - Move source to its next entry
+ * @s: merge source
+ *
+ * Return: true  - source has an entry
+ *         false - source is exhausted (or broken)
+ */
+static bool advance_source(struct spill_source *s)
+{
+	if (!s->fp) {
+		if (!s->left)
+			return false;
+		s->ptr = *s->mem++;
+		s->left--;
+		return true;
+	}
+
+	free(s->cur.name);
+	s->cur.name = NULL;
+	if (spill_read(s->fp, &s->cur))
+		return false;
+	s->ptr = &s->cur;
+	return true;
+}
+
+/**
+ * sift_down - Restore min-heap of merge sources from position `i`
+ * @heap: min-heap of merge sources
+ * @n:    count of sources in heap
+ * @i:    position to sift down
+ * @cmp:  comparator of `struct fileinfo **`
+ */
+static void sift_down(struct spill_source **heap, size_t n, size_t i,
+		int (*cmp)(const void *, const void *))
+{
+	for (;;) {
+		size_t l = 2 * i + 1;
+		size_t m = i;
+		struct spill_source *tmp;
+
+		if (l < n && cmp(&heap[l]->ptr, &heap[m]->ptr) < 0)
+			m = l;
+		if (l + 1 < n && cmp(&heap[l + 1]->ptr, &heap[m]->ptr) < 0)
+			m = l + 1;
+		if (m == i)
+			return;
+		tmp = heap[i];
+		heap[i] = heap[m];
+		heap[m] = tmp;
+		i = m;
+	}
+}
+
+/**
+ * spill_merge - k-way merge of spilled runs and sorted entries in memory
+ * @runs:  spilled runs (each one is sorted by `cmp`)
+ * @nruns: count of runs
+ * @mem:   sorted entries in memory (may be NULL)
+ * @nmem:  count of entries in `mem`
+ * @cmp:   comparator of `struct fileinfo **`, the one used for sorting
+ * @emit:  called for each entry in merged order (non-zero stops merging)
+ * @arg:   passed to `emit`
+ *
+ * Runs are rewound before merging, and not closed.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int spill_merge(FILE **runs, size_t nruns, struct fileinfo **mem, size_t nmem,
+		int (*cmp)(const void *, const void *),
+		int (*emit)(const struct fileinfo *, void *), void *arg)
+{
+	int ret = 0;
+	size_t i, n = 0;
+	struct spill_source *src;
+	struct spill_source **heap;
+
+	src = calloc(nruns + 1, sizeof(*src));
+	heap = calloc(nruns + 1, sizeof(*heap));
+	if (!src || !heap) {
+		ret = ALLOCATION_FAILURE;
+		goto out;
+	}
+
+	for (i = 0; i < nruns; i++) {
+		src[i].fp = runs[i];
+		rewind(runs[i]);
+	}
+	src[nruns].mem = mem;
+	src[nruns].left = mem ? nmem : 0;
+
+	for (i = 0; i <= nruns; i++)
+		if (advance_source(&src[i]))
+			heap[n++] = &src[i];
+	for (i = n / 2; i-- > 0; )
+		sift_down(heap, n, i, cmp);
+
+	while (n) {
+		ret = emit(heap[0]->ptr, arg);
+		if (ret)
+			break;
+		if (!advance_source(heap[0]))
+			heap[0] = heap[--n];
+		sift_down(heap, n, 0, cmp);
+	}
+
+	for (i = 0; i < nruns; i++) {
+		if (ferror(runs[i]))
+			ret = SPILL_FAILURE;
+		free(src[i].cur.name);
+	}
+out:
+	free(heap);
+	free(src);
+	return ret;
+}
+
+/**
+ * write_entry - `emit` callback of spill_merge() writing to a run
+ * @f:   File information
+ * @arg: destination run (FILE *)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int write_entry(const struct fileinfo *f, void *arg)
+{
+	return spill_write((FILE *)arg, f);
+}
+
+/**
+ * spill_collapse - Merge all runs into single run
+ * @runs:  spilled runs. replaced by the merged run on success
+ * @nruns: count of runs. set to 1 on success
+ * @cmp:   comparator of `struct fileinfo **`
+ *
+ * Keeps the count of simultaneously open runs (and file descriptors)
+ * bounded by SPILL_MAX_RUNS.
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int spill_collapse(FILE **runs, size_t *nruns,
+		int (*cmp)(const void *, const void *))
+{
+	int ret;
+	FILE *merged = spill_create();
+
+	if (!merged)
+		return ACCESS_FAILURE;
+
+	ret = spill_merge(runs, *nruns, NULL, 0, cmp, write_entry, merged);
+	if (!ret && fflush(merged))
+		ret = SPILL_FAILURE;
+	if (ret) {
+		fclose(merged);
+		return ret;
+	}
+
+	spill_close(runs, *nruns);
+	runs[0] = merged;
+	*nruns = 1;
+	return 0;
+}
+
+/**
+ * spill_close - Close (and remove) spilled runs
+ * @runs:  spilled runs
+ * @nruns: count of runs
+ */
+void spill_close(FILE **runs, size_t nruns)
+{
+	size_t i;
+
+	for (i = 0; i < nruns; i++)
+		fclose(runs[i]);
+}
@@ -0,0 +1,20 @@
+#ifndef _SPILL_H
+#define _SPILL_H
+
+/**
+ * Maximum count of runs merged at once.
+ * More runs than this are collapsed by an intermediate merge pass.
+ */
+#define SPILL_MAX_RUNS	64
+
+/* spill.c */
+extern FILE *spill_create(void);
+extern int spill_write(FILE *, const struct fileinfo *);
+extern int spill_merge(FILE **, size_t, struct fileinfo **, size_t,
+		int (*)(const void *, const void *),
+		int (*)(const struct fileinfo *, void *), void *);
+extern int spill_collapse(FILE **, size_t *,
+		int (*)(const void *, const void *));
+extern void spill_close(FILE **, size_t);
+
+#endif
@@ -0,0 +1,386 @@
+/**
+ * @file timedstat.c
+ * @brief Metadata system calls bounded by a deadline
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_timedstat(timeout_ms);
+ * 2. timed_fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW);
+ *    (fails with ETIMEDOUT, if no answer within `timeout_ms`)
+ *    timed_readlinkat(), timed_llistxattr() and timed_lgetxattr() alike
+ *
+ * The system calls are run by worker threads, while the caller waits
+ * for the result until the deadline. On timeout, the job is abandoned:
+ * a worker stuck in an unresponsive file system (NFS, ...) keeps its
+ * own copy of the arguments, and releases the job when it returns.
+ * Workers are detached, so they never delay the exit of the process.
+ * Any thread can call these functions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+#include "timedstat.h"
+
+/**
+ * JOB OPERATION
+ */
+enum
+{
+	JOB_STAT,
+	JOB_READLINK,
+	JOB_LISTXATTR,
+	JOB_GETXATTR
+};
+
+/**
+ * struct stat_job - metadata system call handed to worker.
+ * @op:        JOB OPERATION
+ * @dirfd:     Base direcotry file descriptor
+ * @name:      File name (copied)
+ * @attr:      name of extended attribute (copied), for JOB_GETXATTR
+ * @flags:     flags of fstatat()
+ * @status:    result of fstatat()
+ * @buf:       result of readlinkat() and xattr calls (allocated)
+ * @size:      size of `buf`
+ * @ret:       return value of system call
+ * @err:       errno of system call
+ * @started:   worker took the job
+ * @done:      worker finished the job
+ * @abandoned: caller gave up, worker has to release the job
+ * @cond:      signaled when `done`
+ * @next:      next job in queue
+ */
+struct stat_job {
+	int op;
+	int dirfd;
+	char *name;
+	char *attr;
+	int flags;
+	struct stat status;
+	char *buf;
+	size_t size;
+	ssize_t ret;
+	int err;
+	bool started;
+	bool done;
+	bool abandoned;
+	pthread_cond_t cond;
+	struct stat_job *next;
+};
+
+/* deadline of each system call */
+static unsigned long timeout_ms;
+/* queued jobs, and workers */
+static struct stat_job *queue_head;
+static struct stat_job **queue_tail = &queue_head;
+static size_t idle_workers;
+static size_t nworkers;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_work = PTHREAD_COND_INITIALIZER;
+
+/**
+ * init_timedstat - set deadline of metadata system calls
+ * @ms: timeout (milliseconds)
+ */
+void init_timedstat(unsigned long ms)
+{
+	timeout_ms = ms;
+}
+
+/**
+ * free_job - release job
+ * @job: job
+ */
+static void free_job(struct stat_job *job)
+{
+	pthread_cond_destroy(&job->cond);
+	free(job->name);
+	free(job->attr);
+	free(job->buf);
+	free(job);
+}
+
+/**
+ * stat_worker - worker thread. run queued system calls
+ * @arg: Unused
+ *
+ * Return: never
+ */
+static void *stat_worker(void *arg)
+{
+	struct stat_job *job;
+
+	pthread_mutex_lock(&job_lock);
+	for (;;) {
+		while (!queue_head) {
+			idle_workers++;
+			pthread_cond_wait(&job_work, &job_lock);
+			idle_workers--;
+		}
+		job = queue_head;
+		queue_head = job->next;
+		if (!queue_head)
+			queue_tail = &queue_head;
+		job->started = true;
+		pthread_mutex_unlock(&job_lock);
+
+		switch (job->op) {
+		case JOB_STAT:
+			job->ret = fstatat(job->dirfd, job->name,
+						&job->status, job->flags);
+			break;
+		case JOB_READLINK:
+			job->ret = readlinkat(job->dirfd, job->name,
+						job->buf, job->size);
+			break;
+		case JOB_LISTXATTR:
+			job->ret = llistxattr(job->name, job->buf, job->size);
+			break;
+		case JOB_GETXATTR:
+			job->ret = lgetxattr(job->name, job->attr,
+						job->buf, job->size);
+			break;
+		}
+		job->err = errno;
+
+		pthread_mutex_lock(&job_lock);
+		if (job->abandoned) {
+			free_job(job);
+		} else {
+			job->done = true;
+			pthread_cond_signal(&job->cond);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * new_job - allocate job
+ * @op:    JOB OPERATION
+ * @dirfd: Base direcotry file descriptor
+ * @name:  File name
+ *
+ * Return: job, NULL if allocation failed
+ */
+static struct stat_job *new_job(int op, int dirfd, const char *name)
+{
+	struct stat_job *job = calloc(1, sizeof(*job));
+	pthread_condattr_t attr;
+
+	if (!job)
+		return NULL;
+	job->name = strdup(name);
+	if (!job->name) {
+		free(job);
+		return NULL;
+	}
+	job->op = op;
+	job->dirfd = dirfd;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&job->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	return job;
+}
+
+/**
+ * unqueue_job - remove job not yet taken by worker from queue
+ * @job: job
+ */
+static void unqueue_job(struct stat_job *job)
+{
+	struct stat_job **pos;
+
+	for (pos = &queue_head; *pos; pos = &(*pos)->next) {
+		if (*pos == job) {
+			*pos = job->next;
+			if (!*pos)
+				queue_tail = pos;
+			return;
+		}
+	}
+}
+
+/**
+ * run_job - hand job to worker, and wait until it is done or deadline
+ * @job: job
+ *
+ * Return: true  - job is done (caller owns `job`)
+ *         false - deadline has passed (`job` is not owned any more)
+ */
+static bool run_job(struct stat_job *job)
+{
+	struct timespec deadline;
+	pthread_t thread;
+	bool done;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&job_lock);
+	*queue_tail = job;
+	queue_tail = &job->next;
+	if (!idle_workers && nworkers < TIMEDSTAT_WORKERS_MAX &&
+		!pthread_create(&thread, NULL, stat_worker, NULL)) {
+		pthread_detach(thread);
+		nworkers++;
+	} else {
+		pthread_cond_signal(&job_work);
+	}
+
+	while (!job->done)
+		if (pthread_cond_timedwait(&job->cond, &job_lock,
+						&deadline) == ETIMEDOUT)
+			break;
+
+	done = job->done;
+	if (!done && !job->started) {
+		unqueue_job(job);
+		free_job(job);
+	} else if (!done) {
+		job->abandoned = true;
+	}
+	pthread_mutex_unlock(&job_lock);
+	return done;
+}
+
+/**
+ * timed_fstatat - fstatat() bounded by deadline
+ * @dirfd:  Base direcotry file descriptor (or AT_FDCWD)
+ * @name:   File name
+ * @status: Output. File status
+ * @flags:  flags of fstatat()
+ *
+ * Return: 0 - success
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+int timed_fstatat(int dirfd, const char *name, struct stat *status, int flags)
+{
+	struct stat_job *job = new_job(JOB_STAT, dirfd, name);
+	int ret;
+
+	if (!job) {
+		errno = ENOMEM;
+		return -1;
+	}
+	job->flags = flags;
+
+	if (!run_job(job)) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	ret = job->ret;
+	if (!ret)
+		*status = job->status;
+	errno = job->err;
+	free_job(job);
+	return ret;
+}
+
+/**
+ * run_read_job - run job reading into buffer, bounded by deadline
+ * @job:  job (released), NULL if its allocation failed
+ * @buf:  Output. data read by system call
+ * @size: size of `buf` (0 to ask for the size of data)
+ *
+ * The worker reads into a buffer of the job, which is copied to `buf`
+ * only if the job is done in time.
+ *
+ * Return: return value of system call
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+static ssize_t run_read_job(struct stat_job *job, void *buf, size_t size)
+{
+	ssize_t ret;
+
+	if (job && size)
+		job->buf = malloc(size);
+	if (!job || (size && !job->buf)) {
+		if (job)
+			free_job(job);
+		errno = ENOMEM;
+		return -1;
+	}
+	job->size = size;
+
+	if (!run_job(job)) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	ret = job->ret;
+	if (ret > 0 && size)
+		memcpy(buf, job->buf, ret);
+	errno = job->err;
+	free_job(job);
+	return ret;
+}
+
+/**
+ * timed_readlinkat - readlinkat() bounded by deadline
+ * @dirfd: Base direcotry file descriptor (or AT_FDCWD)
+ * @name:  File name
+ * @buf:   Output. Symbolic link target (not terminated by '\0')
+ * @size:  size of `buf`
+ *
+ * Return: length of target
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+ssize_t timed_readlinkat(int dirfd, const char *name, char *buf, size_t size)
+{
+	return run_read_job(new_job(JOB_READLINK, dirfd, name), buf, size);
+}
+
+/**
+ * timed_llistxattr - llistxattr() bounded by deadline
+ * @path: File path
+ * @list: Output. names of attributes (each terminated by '\0')
+ * @size: size of `list` (0 to ask for the size of names)
+ *
+ * Return: bytes of names
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+ssize_t timed_llistxattr(const char *path, char *list, size_t size)
+{
+	return run_read_job(new_job(JOB_LISTXATTR, AT_FDCWD, path),
+								list, size);
+}
+
+/**
+ * timed_lgetxattr - lgetxattr() bounded by deadline
+ * @path:  File path
+ * @attr:  name of attribute
+ * @value: Output. value of attribute
+ * @size:  size of `value` (0 to ask for the size of value)
+ *
+ * Return: bytes of value
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+ssize_t timed_lgetxattr(const char *path, const char *attr, void *value,
+								size_t size)
+{
+	struct stat_job *job = new_job(JOB_GETXATTR, AT_FDCWD, path);
+
+	if (job && !(job->attr = strdup(attr))) {
+		free_job(job);
+		job = NULL;
+	}
+	return run_read_job(job, value, size);
+}
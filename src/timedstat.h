@@ -0,0 +1,16 @@
+#ifndef _TIMEDSTAT_H
+#define _TIMEDSTAT_H
+
+/**
+ * Maximum count of metadata worker threads (including stuck ones).
+ */
+#define TIMEDSTAT_WORKERS_MAX	32
+
+/* timedstat.c */
+extern void init_timedstat(unsigned long);
+extern int timed_fstatat(int, const char *, struct stat *, int);
+extern ssize_t timed_readlinkat(int, const char *, char *, size_t);
+extern ssize_t timed_llistxattr(const char *, char *, size_t);
+extern ssize_t timed_lgetxattr(const char *, const char *, void *, size_t);
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file trace.c
+ * @brief Timeline of listing phases, in Chrome trace event format
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_trace(path);
+ * 2. t = trace_begin();
+ *    (phase)
+ *    trace_end("read", dirname, t); (from any thread)
+ * 3. clean_trace(); (the trace is written to `path`)
+ *
+ * Each thread records its events to its own buffer, without locking.
+ * The buffers are written as JSON ("X" complete events, one "tid" per
+ * thread) when tracing ends, or at exit(). While tracing is disabled,
+ * trace_begin() and trace_end() only test a flag.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "trace.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ *  2: trace file cannot open/write
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1,
+	WRITE_FAILURE = 2
+};
+
+/**
+ * Count of events in a chunk of buffer
+ */
+#define TRACE_CHUNK	1024
+
+/**
+ * struct trace_event - Phase of listing.
+ * @phase: name of phase (static string)
+ * @arg:   directory name (copied), NULL if none
+ * @begin: start time (nanoseconds)
+ * @end:   end time (nanoseconds)
+ */
+struct trace_event {
+	const char *phase;
+	char *arg;
+	uint64_t begin;
+	uint64_t end;
+};
+
+/**
+ * struct trace_chunk - Events of a thread.
+ * @events: events
+ * @count:  count of `events`
+ * @next:   next (older) chunk
+ */
+struct trace_chunk {
+	struct trace_event events[TRACE_CHUNK];
+	size_t count;
+	struct trace_chunk *next;
+};
+
+/**
+ * struct trace_buffer - Buffer of a thread.
+ * @tid:    thread number (in order of first event)
+ * @chunks: chunks (the newest first)
+ * @next:   next buffer
+ */
+struct trace_buffer {
+	unsigned int tid;
+	struct trace_chunk *chunks;
+	struct trace_buffer *next;
+};
+
+static bool tracing;
+static FILE *trace_fp;
+static struct trace_buffer *buffers;
+static unsigned int threads;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+/* buffer of this thread */
+static __thread struct trace_buffer *local;
+
+/**
+ * now_ns - Monotonic time
+ *
+ * Return: nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * trace_begin - Start a phase
+ *
+ * Return: start time of phase (0 if tracing is disabled)
+ */
+uint64_t trace_begin(void)
+{
+	return tracing ? now_ns() : 0;
+}
+
+/**
+ * local_chunk - Chunk of this thread with a free event
+ *
+ * Return: chunk, NULL if allocation failed
+ */
+static struct trace_chunk *local_chunk(void)
+{
+	struct trace_chunk *c;
+
+	if (!local) {
+		local = calloc(1, sizeof(*local));
+		if (!local)
+			return NULL;
+		pthread_mutex_lock(&trace_lock);
+		local->tid = ++threads;
+		local->next = buffers;
+		buffers = local;
+		pthread_mutex_unlock(&trace_lock);
+	}
+
+	c = local->chunks;
+	if (!c || c->count == TRACE_CHUNK) {
+		c = malloc(sizeof(*c));
+		if (!c)
+			return NULL;
+		c->count = 0;
+		c->next = local->chunks;
+		local->chunks = c;
+	}
+	return c;
+}
+
+/**
+ * trace_end - Record a phase
+ * @phase: name of phase (static string)
+ * @arg:   directory name, NULL if none
+ * @begin: return value of trace_begin()
+ *
+ * Events which cannot be allocated are dropped.
+ */
+void trace_end(const char *phase, const char *arg, uint64_t begin)
+{
+	struct trace_chunk *c;
+	struct trace_event *e;
+
+	if (!tracing)
+		return;
+	c = local_chunk();
+	if (!c)
+		return;
+
+	e = &c->events[c->count];
+	e->phase = phase;
+	e->arg = arg ? strdup(arg) : NULL;
+	e->begin = begin;
+	e->end = now_ns();
+	c->count++;
+}
+
+/**
+ * write_string - Write JSON string
+ * @fp: trace file
+ * @s:  string
+ */
+static void write_string(FILE *fp, const char *s)
+{
+	putc('"', fp);
+	for (; *s; s++) {
+		unsigned char ch = *s;
+
+		if (ch == '"' || ch == '\\')
+			fprintf(fp, "\\%c", ch);
+		else if (ch < 0x20)
+			fprintf(fp, "\\u%04x", ch);
+		else
+			putc(ch, fp);
+	}
+	putc('"', fp);
+}
+
+/**
+ * write_trace - Write and release all the events (`trace_lock` is held)
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int write_trace(void)
+{
+	struct trace_buffer *b, *nextb;
+	struct trace_chunk *c, *nextc;
+	const char *sep = "\n";
+	pid_t pid = getpid();
+	size_t i;
+	int ret;
+
+	fputs("{\"traceEvents\":[", trace_fp);
+	for (b = buffers; b; b = nextb) {
+		nextb = b->next;
+		for (c = b->chunks; c; c = nextc) {
+			nextc = c->next;
+			for (i = 0; i < c->count; i++) {
+				struct trace_event *e = &c->events[i];
+
+				fprintf(trace_fp, "%s{\"name\":\"%s\",\"ph\":\"X\","
+					"\"ts\":%.3f,\"dur\":%.3f,"
+					"\"pid\":%d,\"tid\":%u", sep, e->phase,
+					e->begin / 1000.0,
+					(e->end - e->begin) / 1000.0,
+					(int)pid, b->tid);
+				if (e->arg) {
+					fputs(",\"args\":{\"dir\":", trace_fp);
+					write_string(trace_fp, e->arg);
+					putc('}', trace_fp);
+				}
+				putc('}', trace_fp);
+				sep = ",\n";
+				free(e->arg);
+			}
+			free(c);
+		}
+		free(b);
+	}
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", trace_fp);
+
+	ret = ferror(trace_fp) ? WRITE_FAILURE : 0;
+	if (fclose(trace_fp))
+		ret = WRITE_FAILURE;
+	trace_fp = NULL;
+	buffers = NULL;
+	threads = 0;
+	return ret;
+}
+
+/**
+ * trace_atexit - Write the trace at exit()
+ */
+static void trace_atexit(void)
+{
+	pthread_mutex_lock(&trace_lock);
+	if (tracing) {
+		tracing = false;
+		write_trace();
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
+
+/**
+ * init_trace - Start tracing
+ * @path: trace file name (created now, written by clean_trace())
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int init_trace(const char *path)
+{
+	static bool registered;
+
+	trace_fp = fopen(path, "w");
+	if (!trace_fp)
+		return WRITE_FAILURE;
+	if (!registered) {
+		atexit(trace_atexit);
+		registered = true;
+	}
+	tracing = true;
+	return 0;
+}
+
+/**
+ * clean_trace - Stop tracing, and write the trace
+ *
+ * Threads which recorded events (other than the caller) must have
+ * ended.
+ *
+ * Return: 0 - success (or not tracing)
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int clean_trace(void)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&trace_lock);
+	if (tracing) {
+		tracing = false;
+		ret = write_trace();
+	}
+	local = NULL;
+	pthread_mutex_unlock(&trace_lock);
+	return ret;
+}
@@ -0,0 +1,12 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+/* trace.c */
+extern int init_trace(const char *);
+extern uint64_t trace_begin(void);
+extern void trace_end(const char *, const char *, uint64_t);
+extern int clean_trace(void);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file version.c
+ * @brief Sort keys of file names, comparing runs of digits by value
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. key = malloc(version_key(NULL, name) + 1);
+ * 2. version_key(key, name);
+ * 3. strcmp(key, other_key); (version order of names)
+ *
+ * A name is encoded once, so that sorting compares keys as plain strings
+ * without parsing digits on every comparison. Other bytes are copied as
+ * they are. A run of digits is encoded as VERSION_DIGITS, the count of
+ * its digits without leading zeros (one byte, at least 1), and the
+ * digits: a shorter number is smaller, and numbers of the same length
+ * compare digit by digit. So "log.2" < "log.10" and "part-9" =
+ * "part-00009" (left to the caller to break the tie).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "version.h"
+
+/**
+ * is_digit - Check that byte is an ASCII digit (independent of locale)
+ * @c: byte
+ *
+ * Return: non-zero if `c` is '0' to '9'
+ */
+static inline int is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/**
+ * version_key - Encode sort key of name
+ * @dest: Output. key (terminated by '\0'), NULL to count only
+ * @name: File name (NAME_MAX bytes at most, so that each run of digits
+ *        has less than 256 digits)
+ *
+ * Return: length of key (without '\0')
+ */
+size_t version_key(char *dest, const char *name)
+{
+	size_t len = 0;
+	size_t n;
+
+	while (*name) {
+		if (!is_digit(*name)) {
+			if (dest)
+				dest[len] = *name;
+			len++;
+			name++;
+			continue;
+		}
+
+		/* "000" is encoded as "0" */
+		while (name[0] == '0' && is_digit(name[1]))
+			name++;
+		for (n = 0; is_digit(name[n]); n++)
+			;
+		if (dest) {
+			dest[len] = VERSION_DIGITS;
+			dest[len + 1] = (char)(unsigned char)n;
+			memcpy(dest + len + 2, name, n);
+		}
+		len += 2 + n;
+		name += n;
+	}
+	if (dest)
+		dest[len] = '\0';
+	return len;
+}
@@ -0,0 +1,14 @@
+#ifndef _VERSION_H
+#define _VERSION_H
+
+#include <stddef.h>
+
+/**
+ * Key byte starting a run of digits (sorts where digits do)
+ */
+#define VERSION_DIGITS	'0'
+
+/* version.c */
+extern size_t version_key(char *, const char *);
+
+#endif
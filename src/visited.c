@@ -0,0 +1,177 @@
+/**
+ * @file visited.c
+ * @brief set of visited directories (st_dev, st_ino)
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_visited();
+ * 2. if (add_visited(st.st_dev, st.st_ino) == ALREADY_VISITED) (skip)
+ * 3. clean_visited();
+ *
+ * Open addressing (linear probing) hash set, kept at most half full.
+ * A directory is identified by its device and inode, so that the same
+ * directory reached by another name (bind mount, symbolic link, repeated
+ * argument) or a cycle is detected.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "visited.h"
+
+/**
+ * ERROR STATUS CODE
+ *  1: allocation failed(malloc)
+ *  2: already in set (ALREADY_VISITED, see visited.h)
+ */
+enum
+{
+	ALLOCATION_FAILURE = 1
+};
+
+/**
+ * Initial count of buckets (power of 2)
+ */
+#define VISITED_INITIAL_SIZE	64
+
+/**
+ * struct visited_entry - bucket of visited set.
+ * @dev:  device
+ * @ino:  inode
+ * @used: bucket is used
+ */
+struct visited_entry {
+	dev_t dev;
+	ino_t ino;
+	bool used;
+};
+
+/* buckets of set */
+static struct visited_entry *table;
+/* count of buckets (power of 2), and count of used buckets */
+static size_t size;
+static size_t count;
+
+/**
+ * hash_id - hash of (dev, ino)
+ * @dev: device
+ * @ino: inode
+ *
+ * Return: hash value
+ */
+static inline size_t hash_id(dev_t dev, ino_t ino)
+{
+	uint64_t h = (uint64_t)ino ^ ((uint64_t)dev * 0x9e3779b97f4a7c15ULL);
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return (size_t)h;
+}
+
+/**
+ * find_bucket - search bucket of (dev, ino)
+ * @t:   buckets
+ * @n:   count of buckets
+ * @dev: device
+ * @ino: inode
+ *
+ * Return: bucket of (dev, ino), or empty bucket to store it
+ */
+static struct visited_entry *find_bucket(struct visited_entry *t, size_t n,
+						dev_t dev, ino_t ino)
+{
+	size_t i;
+
+	for (i = hash_id(dev, ino) & (n - 1); t[i].used; i = (i + 1) & (n - 1))
+		if (t[i].dev == dev && t[i].ino == ino)
+			break;
+	return &t[i];
+}
+
+/**
+ * init_visited - Initialize visited set
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int init_visited(void)
+{
+	size = VISITED_INITIAL_SIZE;
+	count = 0;
+	table = calloc(size, sizeof(*table));
+	if (!table) {
+		size = 0;
+		return ALLOCATION_FAILURE;
+	}
+	return 0;
+}
+
+/**
+ * expand_visited - double buckets of visited set
+ *
+ * Return: 0 - success
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+static int expand_visited(void)
+{
+	struct visited_entry *new;
+	size_t i;
+
+	new = calloc(size * 2, sizeof(*new));
+	if (!new)
+		return ALLOCATION_FAILURE;
+
+	for (i = 0; i < size; i++)
+		if (table[i].used)
+			*find_bucket(new, size * 2, table[i].dev,
+						table[i].ino) = table[i];
+	free(table);
+	table = new;
+	size *= 2;
+	return 0;
+}
+
+/**
+ * add_visited - Add directory to visited set
+ * @dev: device
+ * @ino: inode
+ *
+ * A directory already in set is detected even if the set cannot grow.
+ *
+ * Return: 0 - success (first visit)
+ *         otherwise - error(show ERROR STATUS CODE)
+ */
+int add_visited(dev_t dev, ino_t ino)
+{
+	struct visited_entry *e;
+
+	e = find_bucket(table, size, dev, ino);
+	if (e->used)
+		return ALREADY_VISITED;
+
+	if (2 * (count + 1) > size) {
+		if (expand_visited())
+			return ALLOCATION_FAILURE;
+		e = find_bucket(table, size, dev, ino);
+	}
+
+	e->dev = dev;
+	e->ino = ino;
+	e->used = true;
+	count++;
+	return 0;
+}
+
+/**
+ * clean_visited - clean up visited set
+ */
+void clean_visited(void)
+{
+	free(table);
+	table = NULL;
+	size = 0;
+	count = 0;
+}
@@ -0,0 +1,14 @@
+#ifndef _VISITED_H
+#define _VISITED_H
+
+#include <sys/types.h>
+
+/* add_visited() of a directory already in set */
+#define ALREADY_VISITED	2
+
+/* visited.c */
+extern int init_visited(void);
+extern int add_visited(dev_t, ino_t);
+extern void clean_visited(void);
+
+#endif
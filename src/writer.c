@@ -0,0 +1,278 @@
+/**
+ * @file writer.c
+ * @brief Output stream drained by a writer thread
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. FILE *fp = init_writer(STDOUT_FILENO);
+ * 2. fprintf(fp, ...); (only one thread may write to `fp`)
+ * 3. clean_writer(); (`fp` is closed)
+ *
+ * The stream is fully buffered by stdio. Each time its buffer is
+ * flushed, the data is copied to one of WRITER_BUFFERS buffers, and
+ * written to the file descriptor by the writer thread, while the caller
+ * goes on formatting. When all the buffers are waiting to be written,
+ * the caller waits for one of them (bounded backpressure).
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	/* fopencookie() */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "writer.h"
+#include "trace.h"
+
+/**
+ * struct writer_buffer - Data waiting to be written.
+ * @data: data
+ * @len:  length of `data`
+ */
+struct writer_buffer {
+	char data[WRITER_BUFFER_SIZE];
+	size_t len;
+};
+
+/**
+ * struct writer - Ring of buffers, and the writer thread.
+ * @ring:   buffers (ring buffer of WRITER_BUFFERS)
+ * @head:   index of oldest buffer waiting (next written)
+ * @count:  count of buffers waiting
+ * @stop:   writer thread should exit, once the ring is empty
+ * @err:    errno of failed write(2), 0 if none
+ * @fd:     output file descriptor
+ * @fp:     stream given to the caller
+ * @thread: writer thread
+ * @lock:   protects all of the above
+ * @filled: signaled when a buffer is queued (or `stop` is set)
+ * @freed:  signaled when a buffer is written
+ */
+struct writer {
+	struct writer_buffer ring[WRITER_BUFFERS];
+	size_t head;
+	size_t count;
+	bool stop;
+	int err;
+	int fd;
+	FILE *fp;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t filled;
+	pthread_cond_t freed;
+};
+
+static struct writer *writer;
+/* writer_atexit() is registered ('--daemon' starts a writer per request) */
+static bool registered;
+
+/**
+ * writer_thread - Write queued buffers, in order
+ * @arg: writer
+ *
+ * Once a write(2) has failed, the following buffers are dropped.
+ *
+ * Return: NULL
+ */
+static void *writer_thread(void *arg)
+{
+	struct writer *w = arg;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		struct writer_buffer *b;
+		size_t off = 0;
+		uint64_t t;
+		int err;
+
+		while (!w->count && !w->stop)
+			pthread_cond_wait(&w->filled, &w->lock);
+		if (!w->count)
+			break;
+
+		b = &w->ring[w->head];
+		err = w->err;
+		pthread_mutex_unlock(&w->lock);
+		t = trace_begin();
+		while (off < b->len && !err) {
+			ssize_t n = write(w->fd, b->data + off, b->len - off);
+
+			if (n < 0 && errno != EINTR)
+				err = errno;
+			else if (n > 0)
+				off += n;
+		}
+		trace_end("write", NULL, t);
+		pthread_mutex_lock(&w->lock);
+
+		w->err = err;
+		w->head = (w->head + 1) % WRITER_BUFFERS;
+		w->count--;
+		pthread_cond_signal(&w->freed);
+	}
+	pthread_mutex_unlock(&w->lock);
+	return NULL;
+}
+
+/**
+ * writer_write - `write` of the stream, queue the data
+ * @cookie: writer
+ * @buf:    data
+ * @size:   length of `buf`
+ *
+ * Return: size (queued)
+ *         -1 - a previous write(2) has failed
+ */
+static ssize_t writer_write(void *cookie, const char *buf, size_t size)
+{
+	struct writer *w = cookie;
+	size_t done = 0;
+
+	pthread_mutex_lock(&w->lock);
+	while (done < size && !w->err) {
+		struct writer_buffer *b;
+		size_t len = size - done;
+
+		while (w->count == WRITER_BUFFERS)
+			pthread_cond_wait(&w->freed, &w->lock);
+
+		if (len > WRITER_BUFFER_SIZE)
+			len = WRITER_BUFFER_SIZE;
+		b = &w->ring[(w->head + w->count) % WRITER_BUFFERS];
+		memcpy(b->data, buf + done, len);
+		b->len = len;
+		w->count++;
+		done += len;
+		pthread_cond_signal(&w->filled);
+	}
+	if (w->err) {
+		errno = w->err;
+		done = 0;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return done ? done : -1;
+}
+
+/**
+ * writer_drain - Wait until all the queued buffers are written
+ * @w: writer
+ */
+static void writer_drain(struct writer *w)
+{
+	pthread_mutex_lock(&w->lock);
+	while (w->count)
+		pthread_cond_wait(&w->freed, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * flush_writer - Write out the stream, and wait until it is written
+ *
+ * Return: 0 - all the data is written
+ *         otherwise - errno of failed write
+ */
+int flush_writer(void)
+{
+	struct writer *w = writer;
+	int err;
+
+	if (!w)
+		return 0;
+	fflush(w->fp);
+	writer_drain(w);
+
+	pthread_mutex_lock(&w->lock);
+	err = w->err;
+	pthread_mutex_unlock(&w->lock);
+	return err;
+}
+
+/**
+ * writer_atexit - Write out the stream at exit()
+ *
+ * Streams are flushed by exit() only after atexit handlers, when the
+ * writer thread may not run anymore. So flush and drain here.
+ */
+static void writer_atexit(void)
+{
+	flush_writer();
+}
+
+/**
+ * init_writer - Start writer thread, and create stream for it
+ * @fd: output file descriptor
+ *
+ * Return: stream, or NULL if the writer cannot be started
+ */
+FILE *init_writer(int fd)
+{
+	cookie_io_functions_t io = { NULL, writer_write, NULL, NULL };
+	struct writer *w;
+
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		return NULL;
+	w->fd = fd;
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->filled, NULL);
+	pthread_cond_init(&w->freed, NULL);
+
+	w->fp = fopencookie(w, "w", io);
+	if (!w->fp)
+		goto err;
+	if (setvbuf(w->fp, NULL, _IOFBF, WRITER_BUFFER_SIZE) ||
+		pthread_create(&w->thread, NULL, writer_thread, w)) {
+		fclose(w->fp);
+		goto err;
+	}
+
+	writer = w;
+	if (!registered) {
+		atexit(writer_atexit);
+		registered = true;
+	}
+	return w->fp;
+
+err:
+	pthread_cond_destroy(&w->freed);
+	pthread_cond_destroy(&w->filled);
+	pthread_mutex_destroy(&w->lock);
+	free(w);
+	return NULL;
+}
+
+/**
+ * clean_writer - Close the stream, and stop writer thread
+ *
+ * Return: 0 - all the data is written
+ *         otherwise - errno of failed write
+ */
+int clean_writer(void)
+{
+	struct writer *w = writer;
+	int err;
+
+	if (!w)
+		return 0;
+
+	err = fclose(w->fp) ? errno : 0;
+	pthread_mutex_lock(&w->lock);
+	w->stop = true;
+	pthread_cond_signal(&w->filled);
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->thread, NULL);
+	if (w->err)
+		err = w->err;
+
+	writer = NULL;
+	pthread_cond_destroy(&w->freed);
+	pthread_cond_destroy(&w->filled);
+	pthread_mutex_destroy(&w->lock);
+	free(w);
+	return err;
+}
@@ -0,0 +1,20 @@
+#ifndef _WRITER_H
+#define _WRITER_H
+
+/**
+ * Count of buffers waiting to be written ("--async-output").
+ * The formatting thread waits when all of them are full.
+ */
+#define WRITER_BUFFERS		2
+
+/**
+ * Size of each buffer (and of stdio buffer of the stream)
+ */
+#define WRITER_BUFFER_SIZE	(64 * 1024)
+
+/* writer.c */
+extern FILE *init_writer(int);
+extern int flush_writer(void);
+extern int clean_writer(void);
+
+#endif
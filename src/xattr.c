@@ -0,0 +1,245 @@
+/**
+ * @file xattr.c
+ * @brief ACL and security context indicators from extended attributes
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ * 1. init_xattr(timed);
+ * 2. indicator = xattr_probe(dirfd, dirname, name, st.st_dev, &context);
+ *    ('+' ACL, '.' security context, '?' unknown, '\0' none)
+ *
+ * Each entry costs one llistxattr(), and lgetxattr() only if its
+ * security context is asked for. Each of these system calls takes a
+ * token of '--max-iops' (see ratelimit.c). The entry is reached through the
+ * descriptor of its directory (/proc/self/fd/N/name), without looking
+ * up the directory again. If `timed`, the system calls are bounded by
+ * '--stat-timeout' (see timedstat.c), and an entry whose attributes are
+ * not answered in time is shown as unknown. A file system which answers ENOTSUP is
+ * remembered by its device, and its entries are not probed any more.
+ * Any thread can call these functions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+#include "xattr.h"
+#include "ratelimit.h"
+#include "timedstat.h"
+
+/**
+ * Size of the list of attribute names read at first
+ */
+#define XATTR_LIST_SIZE	1024
+
+/* attributes of ACL, and of security context */
+static const char *const acl_names[] = {
+	"system.posix_acl_access",
+	"system.posix_acl_default",
+	NULL
+};
+static const char context_name[] = "security.selinux";
+
+/* /proc/self/fd can be used to reach entries of directory */
+static bool use_procfd;
+/* system calls are bounded by deadline */
+static bool use_timed;
+/* devices of file systems which do not support xattrs */
+static dev_t nosupport[XATTR_NOSUPPORT_MAX];
+static size_t nnosupport;
+static pthread_mutex_t xattr_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * init_xattr - Prepare to probe entries
+ * @timed: bound system calls by deadline (timedstat.c is initialized)
+ */
+void init_xattr(bool timed)
+{
+	use_procfd = !access("/proc/self/fd", X_OK);
+	use_timed = timed;
+}
+
+/**
+ * list_attrs - llistxattr() taking token of '--max-iops'
+ * @path: path of entry
+ * @list: Output. names of attributes
+ * @size: size of `list` (0 to ask for the size of names)
+ *
+ * Return: bytes of names
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+static ssize_t list_attrs(const char *path, char *list, size_t size)
+{
+	ratelimit_take(1);
+	if (use_timed)
+		return timed_llistxattr(path, list, size);
+	return llistxattr(path, list, size);
+}
+
+/**
+ * get_attr - lgetxattr() taking token of '--max-iops'
+ * @path:  path of entry
+ * @value: Output. value of attribute
+ * @size:  size of `value` (0 to ask for the size of value)
+ *
+ * Return: bytes of value
+ *         -1 - error (errno is ETIMEDOUT, if deadline has passed)
+ */
+static ssize_t get_attr(const char *path, void *value, size_t size)
+{
+	ratelimit_take(1);
+	if (use_timed)
+		return timed_lgetxattr(path, context_name, value, size);
+	return lgetxattr(path, context_name, value, size);
+}
+
+/**
+ * supported - Check that file system may support xattrs
+ * @dev: device of file system
+ *
+ * Return: false if the file system answered ENOTSUP before
+ */
+static bool supported(dev_t dev)
+{
+	bool ret = true;
+	size_t i;
+
+	pthread_mutex_lock(&xattr_lock);
+	for (i = 0; i < nnosupport; i++)
+		if (nosupport[i] == dev)
+			ret = false;
+	pthread_mutex_unlock(&xattr_lock);
+	return ret;
+}
+
+/**
+ * set_nosupport - Remember file system which does not support xattrs
+ * @dev: device of file system
+ */
+static void set_nosupport(dev_t dev)
+{
+	pthread_mutex_lock(&xattr_lock);
+	if (nnosupport < XATTR_NOSUPPORT_MAX)
+		nosupport[nnosupport++] = dev;
+	pthread_mutex_unlock(&xattr_lock);
+}
+
+/**
+ * has_name - Check that list of attributes has name
+ * @list: names of attributes (each terminated by '\0')
+ * @len:  bytes of `list`
+ * @name: name of attribute
+ *
+ * Return: true if found
+ */
+static bool has_name(const char *list, ssize_t len, const char *name)
+{
+	const char *p;
+
+	for (p = list; p < list + len; p += strlen(p) + 1)
+		if (!strcmp(p, name))
+			return true;
+	return false;
+}
+
+/**
+ * read_context - Read security context of entry
+ * @path: path of entry
+ *
+ * Return: context (release by free()), NULL if none
+ */
+static char *read_context(const char *path)
+{
+	ssize_t len;
+	char *context;
+
+	len = get_attr(path, NULL, 0);
+	if (len <= 0)
+		return NULL;
+	context = malloc(len + 1);
+	if (!context)
+		return NULL;
+	len = get_attr(path, context, len);
+	if (len <= 0) {
+		free(context);
+		return NULL;
+	}
+	/* the value may or may not be terminated by '\0' */
+	context[len] = '\0';
+	return context;
+}
+
+/**
+ * xattr_probe - Probe ACL and security context of entry
+ * @dirfd:   Base direcotry file descriptor (or AT_FDCWD)
+ * @dirname: Base direcotry name ("" if none)
+ * @name:    File name, relative to `dirfd`
+ * @dev:     device of entry (st_dev)
+ * @context: Output. security context (release by free()), NULL if none.
+ *           NULL if not asked.
+ *
+ * Return: '+' - entry has ACL
+ *         '.' - entry has security context (and no ACL)
+ *         '?' - attributes are not answered within deadline
+ *         '\0' - none (or not supported)
+ */
+char xattr_probe(int dirfd, const char *dirname, const char *name,
+						dev_t dev, char **context)
+{
+	char path[PATH_MAX + 32];
+	char buf[XATTR_LIST_SIZE];
+	char *list = buf;
+	ssize_t len;
+	char indicator = '\0';
+	int i;
+
+	if (context)
+		*context = NULL;
+	if (!supported(dev))
+		return '\0';
+
+	if (name[0] == '/' || dirfd == AT_FDCWD)
+		snprintf(path, sizeof(path), "%s", name);
+	else if (use_procfd)
+		snprintf(path, sizeof(path), "/proc/self/fd/%d/%s", dirfd, name);
+	else
+		snprintf(path, sizeof(path), "%s/%s", dirname, name);
+
+	len = list_attrs(path, list, sizeof(buf));
+	if (len < 0 && errno == ERANGE) {
+		len = list_attrs(path, NULL, 0);
+		list = len > 0 ? malloc(len) : NULL;
+		if (list)
+			len = list_attrs(path, list, len);
+		else if (len >= 0)
+			len = -1;
+	}
+	if (len < 0) {
+		if (errno == ENOTSUP || errno == ENOSYS)
+			set_nosupport(dev);
+		else if (errno == ETIMEDOUT)
+			indicator = '?';
+		goto out;
+	}
+
+	for (i = 0; acl_names[i]; i++)
+		if (has_name(list, len, acl_names[i]))
+			indicator = '+';
+	if (has_name(list, len, context_name)) {
+		if (!indicator)
+			indicator = '.';
+		if (context)
+			*context = read_context(path);
+	}
+out:
+	if (list != buf)
+		free(list);
+	return indicator;
+}
@@ -0,0 +1,16 @@
+#ifndef _XATTR_H
+#define _XATTR_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * Maximum count of file systems remembered not to support xattrs
+ */
+#define XATTR_NOSUPPORT_MAX	64
+
+/* xattr.c */
+extern void init_xattr(bool);
+extern char xattr_probe(int, const char *, const char *, dev_t, char **);
+
+#endif
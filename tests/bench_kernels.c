@@ -0,0 +1,341 @@
+/**
+ * @file bench_kernels.c
+ * @brief Micro benchmarks of per-entry routines in main.c
+ * @author LeavaTail
+ * @date 2026/10/18
+ *
+ * HOW TO USE
+ *   make bench
+ *   ./bench_kernels [ENTRIES]   (default 200000)
+ *
+ * src/main.c is included, so that its static routines can be called.
+ * Entries are synthesized in memory and the output is discarded,
+ * so that no file system is involved in the measurement.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1	/* fopencookie() */
+#endif
+#define main pdir_main
+#include "../src/main.c"
+#undef main
+
+/**
+ * Default count of synthetic entries
+ */
+#define BENCH_ENTRIES	200000
+
+/* Keep results alive, so that the compiler cannot drop the work */
+static volatile size_t bench_sink;
+
+/**
+ * discard_write - write function of the stream discarding output
+ * @cookie: Unused
+ * @buf:    Output data
+ * @size:   size of `buf`
+ *
+ * Return: size (all written)
+ */
+static ssize_t discard_write(void *cookie, const char *buf, size_t size)
+{
+	bench_sink += size;
+	return size;
+}
+
+/**
+ * elapsed_ns - nanoseconds since `start`
+ * @start: start time (CLOCK_MONOTONIC)
+ *
+ * Return: elapsed time (ns)
+ */
+static double elapsed_ns(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e9 +
+				(now.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * report - print result of one kernel
+ * @kernel: kernel name
+ * @ns:     elapsed time (ns)
+ * @n:      count of entries
+ */
+static void report(const char *kernel, double ns, size_t n)
+{
+	printf("%-28s %10.1f ns/entry\n", kernel, ns / n);
+}
+
+/**
+ * make_entries - synthesize File information slots
+ * @s: File information slots (initialized)
+ * @n: count of entries
+ *
+ * Names are a mix of regular files, directories, dot-files, "." and "..",
+ * in random order. Status fields are spread so that every column width
+ * and every file type letter is used.
+ */
+static void make_entries(struct fileslots *s, size_t n)
+{
+	static const mode_t types[] = {
+		S_IFREG, S_IFREG, S_IFREG, S_IFDIR, S_IFLNK, S_IFIFO, S_IFSOCK
+	};
+	size_t i;
+	char name[64];
+
+	srand(1);
+	for (i = 0; i < n; i++) {
+		struct fileinfo *f;
+
+		if (s->alloc_count <= i) {
+			s->alloc_count *= 2;
+			s->files = realloc(s->files,
+					s->alloc_count * sizeof(*s->files));
+			s->sorted = realloc(s->sorted,
+					s->alloc_count * sizeof(*s->sorted));
+			if (!s->files || !s->sorted)
+				exit(ALLOCATION_FAILURE);
+		}
+
+		if (i < 2)
+			strcpy(name, i ? ".." : ".");
+		else if (rand() % 10 == 0)
+			sprintf(name, ".hidden-%08x", rand());
+		else
+			sprintf(name, "file-%08x.c", rand());
+
+		f = &s->files[i];
+		memset(f, '\0', sizeof(*f));
+		f->name = strdup(name);
+		if (!f->name)
+			exit(ALLOCATION_FAILURE);
+		f->status.st_mode = types[rand() % 7] | (rand() & 07777);
+		f->status.st_nlink = 1 + rand() % 4;
+		f->status.st_uid = getuid();
+		f->status.st_gid = getgid();
+		f->status.st_size = rand() % 100000000;
+		f->status.st_mtim.tv_sec = current.tv_sec - rand() % 100000000;
+	}
+	s->unused_index = n;
+	s->nlink_width = 1;
+	s->user_width = strlen(getuser(getuid()) ? getuser(getuid()) : "0");
+	s->group_width = strlen(getgroup(getgid()) ? getgroup(getgid()) : "0");
+	s->file_size_width = 8;
+}
+
+/**
+ * bench_joinpath - joinpath() for each entry
+ * @s: File information slots
+ */
+static void bench_joinpath(const struct fileslots *s)
+{
+	struct timespec start;
+	char dest[PATH_MAX];
+	size_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < s->unused_index; i++) {
+		joinpath(dest, "/var/spool/pdir/bench", s->files[i].name);
+		bench_sink += dest[0];
+	}
+	report("joinpath", elapsed_ns(&start), s->unused_index);
+}
+
+/**
+ * bench_ignored - file_ignored() and dot_entry() for each entry
+ * @s: File information slots
+ */
+static void bench_ignored(const struct fileslots *s)
+{
+	static const char *const label[] = {
+		"file_ignored (default)",
+		"file_ignored (-A)",
+		"file_ignored (-a)"
+	};
+	struct timespec start;
+	size_t i;
+	int mode;
+
+	for (mode = PRINT_DEFAULT; mode <= PRINT_ALL; mode++) {
+		print_mode = mode;
+		resolve_modes();
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < s->unused_index; i++)
+			bench_sink += file_ignored(s->files[i].name);
+		report(label[mode], elapsed_ns(&start), s->unused_index);
+	}
+	print_mode = PRINT_DEFAULT;
+	resolve_modes();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < s->unused_index; i++)
+		bench_sink += dot_entry(s->files[i].name);
+	report("dot_entry", elapsed_ns(&start), s->unused_index);
+}
+
+/**
+ * bench_filemode - get_filemode() (and ftypelet()) for each entry
+ * @s: File information slots
+ */
+static void bench_filemode(const struct fileslots *s)
+{
+	struct timespec start;
+	char mode[FILETYPE_SIZE];
+	size_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < s->unused_index; i++) {
+		get_filemode(s->files[i].status.st_mode, mode);
+		bench_sink += mode[0];
+	}
+	report("get_filemode", elapsed_ns(&start), s->unused_index);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < s->unused_index; i++)
+		bench_sink += ftypelet(s->files[i].status.st_mode);
+	report("ftypelet", elapsed_ns(&start), s->unused_index);
+}
+
+/**
+ * bench_sort - sortfiles_slots() of all entries, against serial qsort()
+ * @s: File information slots
+ *
+ * sortfiles_slots() sorts large slots in parallel; the order must be
+ * identical to the one of qsort() with the same comparator.
+ */
+static void bench_sort(struct fileslots *s)
+{
+	struct timespec start;
+	struct fileinfo **serial;
+	size_t i, n = s->unused_index;
+
+	serial = malloc(n * sizeof(*serial));
+	if (!serial)
+		exit(ALLOCATION_FAILURE);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sortfiles_slots(s);
+	report("sortfiles_slots", elapsed_ns(&start), n);
+
+	for (i = 0; i < n; i++)
+		serial[i] = &s->files[i];
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	qsort(serial, n, sizeof(*serial), compare_slots);
+	report("qsort (serial)", elapsed_ns(&start), n);
+
+	if (memcmp(serial, s->sorted, n * sizeof(*serial))) {
+		fprintf(stderr, "sortfiles_slots: order differs from qsort\n");
+		exit(EXIT_FAILURE);
+	}
+	free(serial);
+}
+
+/**
+ * bench_version - version sort ('-v') with and without precomputed keys
+ * @s: File information slots
+ *
+ * Without keys, compare_version() encodes both names on every call.
+ */
+static void bench_version(struct fileslots *s)
+{
+	struct timespec start;
+	char **keys;
+	size_t i, n = s->unused_index;
+
+	keys = malloc(n * sizeof(*keys));
+	if (!keys)
+		exit(ALLOCATION_FAILURE);
+	version_sort = true;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++) {
+		keys[i] = malloc(version_key(NULL, s->files[i].name) + 1);
+		if (!keys[i])
+			exit(ALLOCATION_FAILURE);
+		version_key(keys[i], s->files[i].name);
+		s->files[i].key = keys[i];
+	}
+	report("version_key", elapsed_ns(&start), n);
+
+	for (i = 0; i < n; i++)
+		s->sorted[i] = &s->files[i];
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sortfiles_slots(s);
+	report("sortfiles_slots -v (keys)", elapsed_ns(&start), n);
+
+	for (i = 0; i < n; i++) {
+		s->files[i].key = NULL;
+		s->sorted[i] = &s->files[i];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sortfiles_slots(s);
+	report("sortfiles_slots -v (no keys)", elapsed_ns(&start), n);
+
+	for (i = 0; i < n; i++)
+		free(keys[i]);
+	free(keys);
+	version_sort = false;
+	sortfiles_slots(s);
+}
+
+/**
+ * bench_long - long format printer for each entry
+ * @s: File information slots (sorted)
+ */
+static void bench_long(const struct fileslots *s)
+{
+	cookie_io_functions_t io = { NULL, discard_write, NULL, NULL };
+	struct timespec start;
+	FILE *out = fopencookie(NULL, "w", io);
+	size_t i;
+
+	if (!out)
+		exit(ALLOCATION_FAILURE);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < s->unused_index; i++) {
+		printer->entry(out, s, s->sorted[i]);
+		putc('\n', out);
+	}
+	fflush(out);
+	report("print_long_mtime", elapsed_ns(&start), s->unused_index);
+	fclose(out);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n = BENCH_ENTRIES;
+
+	if (argc > 1 && !parse_count(argv[1], &n)) {
+		fprintf(stderr, "Usage: %s [ENTRIES]\n", argv[0]);
+		return CMDLINE_FAILURE;
+	}
+	if (!n)
+		n = 1;
+
+	ignore_patterns = init_patterns();
+	hide_patterns = init_patterns();
+	print_format = PRINT_LONG_FORMAT;
+	resolve_modes();
+	clock_gettime(CLOCK_REALTIME, &current);
+	year_ago.tv_sec = current.tv_sec - (365.2425 * 24 * 60 * 60);
+	year_ago.tv_nsec = current.tv_nsec;
+
+	init_slots(&slots);
+	make_entries(&slots, n);
+	printf("%zu entries\n", n);
+
+	bench_joinpath(&slots);
+	bench_ignored(&slots);
+	bench_filemode(&slots);
+	bench_sort(&slots);
+	bench_version(&slots);
+	bench_long(&slots);
+
+	clean_slots(&slots);
+	clean_idcache();
+	clean_patterns(ignore_patterns);
+	clean_patterns(hide_patterns);
+	return 0;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Startup latency of pdir listing a tiny directory (run by "make bench")
+#
+# HOW TO USE
+#   tests/bench_startup.sh [RUNS] [PROGRAM]...   (default 1000 ./pdir)
+#
+# Each PROGRAM lists a directory of 3 files RUNS times, with the output
+# discarded. The mean wall time per run includes fork and exec, which are
+# the same for every PROGRAM; compare the programs with each other.
+
+runs=${1:-1000}
+[ $# -gt 0 ] && shift
+[ $# -eq 0 ] && set -- ./pdir
+
+dir=$(mktemp -d) || exit 1
+touch "$dir/a" "$dir/b" "$dir/c"
+
+for prog in "$@"; do
+	for args in "" "-l"; do
+		start=$(date +%s%N)
+		i=0
+		while [ $i -lt "$runs" ]; do
+			"$prog" $args "$dir" > /dev/null
+			i=$((i + 1))
+		done
+		end=$(date +%s%N)
+		printf "%-30s %-3s %8d us/run\n" "$prog" "$args" \
+			$(((end - start) / runs / 1000))
+	done
+done
+
+rm -rf "$dir"
@@ -1,4 +1,4 @@
-#/bin/sh
+#!/bin/sh
 # make sure pdir simply. FIXME
 
 ## Initialize
@@ -7,27 +7,218 @@ mkdir dir
 touch dir/file1
 echo "FILE" > dir/file2
 echo "IGNORE" > dir/.file3
+mkdir dir2
+touch dir2/file0 dir2/file3
+mkdir big
+for i in $(seq 300); do
+	touch big/file$i
+done
 
 ## Check routine
-/.pdir
+./pdir
 if [ $? -gt 0 ]; then
-	return 1;
+	exit 1;
 fi
 
 ./pdir -a
 if [ $? -gt 0 ]; then
-	return 2;
+	exit 2;
 fi
 
 ./pdir -A
 if [ $? -gt 0 ]; then
-	return 3;
+	exit 3;
 fi
 
 ./pdir -l
 if [ $? -gt 0 ]; then
-	return 4;
+	exit 4;
+fi
+
+[ "$(./pdir -I file1 dir | tail -n 1)" = "file2" ] && \
+	[ "$(./pdir --hide='file?' dir)" = "dir:" ] && \
+	[ "$(./pdir -A --hide='file?' dir | wc -l)" = 4 ]
+if [ $? -gt 0 ]; then
+	exit 5;
+fi
+
+[ "$(./pdir -l --memory-limit=1K big)" = "$(./pdir -l big)" ] && \
+	TMPDIR=nonexistent ./pdir --memory-limit=1K big 2>&1 >/dev/null | \
+	grep -q 'temporary file'
+if [ $? -gt 0 ]; then
+	exit 6;
+fi
+
+[ "$(./pdir -l --prefetch=2 dir big dir2)" = "$(./pdir -l dir big dir2)" ]
+if [ $? -gt 0 ]; then
+	exit 7;
+fi
+
+[ "$(./pdir --head=1 dir | tail -n 1)" = "file1" ] && \
+	[ "$(./pdir -l --tail=1 dir | tail -n 1)" = "$(./pdir -l dir | tail -n 1)" ]
+if [ $? -gt 0 ]; then
+	exit 8;
+fi
+
+touch dir2/x.c
+[ "$(LS_COLORS='di=01;34:*.c=33' ./pdir --color=always dir2 | grep x.c)" = \
+	"$(printf '\033[33mx.c\033[0m')" ]
+status=$?
+rm dir2/x.c
+if [ $status -gt 0 ]; then
+	exit 9;
+fi
+
+[ "$(./pdir -l --stat-timeout=1000 dir)" = "$(./pdir -l dir)" ]
+if [ $? -gt 0 ]; then
+	exit 10;
+fi
+
+[ "$(./pdir --dedupe dir dir/ ./dir 2>/dev/null | grep -c '^file1$')" = 1 ]
+if [ $? -gt 0 ]; then
+	exit 11;
+fi
+
+./pdir -l --save-snapshot=snapshot dir >/dev/null && touch dir/file4 && \
+	[ "$(./pdir --diff-snapshot=snapshot dir | tail -n 1)" = "+ file4" ]
+status=$?
+rm -f dir/file4
+if [ $status -gt 0 ]; then
+	exit 12;
+fi
+
+./pdir --error-summary dir nonexistent 2>&1 >/dev/null | \
+	grep -q '^pdir: cannot access (No such file or directory): 1$'
+if [ $? -gt 0 ]; then
+	exit 13;
+fi
+
+[ "$(./pdir -l --async-output dir big | cat)" = "$(./pdir -l dir big)" ]
+if [ $? -gt 0 ]; then
+	exit 14;
+fi
+
+[ "$(./pdir --checkpoint=checkpoint dir)" = "$(./pdir dir)" ] && \
+	test ! -e checkpoint
+if [ $? -gt 0 ]; then
+	exit 15;
+fi
+
+./pdir --estimate=2 big | grep -q '^entries: 300 (sampled 2)$' && \
+	./pdir --estimate dir | grep -q '^size: 5 +/- 0$'
+if [ $? -gt 0 ]; then
+	exit 16;
+fi
+
+[ "$(./pdir --merge dir dir2 | tr -s ' ' | tr '\n' ,)" = \
+	"dir2 file0,dir file1,dir file2,dir2 file3," ] && \
+	[ "$(./pdir -l --merge --prefetch=2 dir dir2 | cut -c 7-)" = \
+	"$(./pdir -l dir dir2 | grep '^-' | sort -k 9)" ]
+if [ $? -gt 0 ]; then
+	exit 17;
+fi
+
+./pdir --daemon=pdir.sock &
+daemon=$!
+sleep 1
+[ "$(LS_COLORS='*.c=32' ./pdir --connect=pdir.sock --color=always -l dir)" = \
+	"$(LS_COLORS='*.c=32' ./pdir --color=always -l dir)" ] && \
+	[ "$(./pdir --connect=nonexistent.sock dir)" = "$(./pdir dir)" ]
+status=$?
+kill $daemon
+if [ $status -gt 0 ]; then
+	exit 18;
+fi
+
+./pdir --trace=trace.json dir >/dev/null && \
+	grep -q '^{"traceEvents":\[' trace.json
+if [ $? -gt 0 ]; then
+	exit 19;
+fi
+
+mkdir quote
+touch "quote/$(printf 'new\nline')"
+./pdir -q quote | grep -q '^new?line$' && ./pdir -b quote | grep -q '^new\\nline$'
+if [ $? -gt 0 ]; then
+	exit 20;
+fi
+
+mkdir dir/subdir
+[ "$(./pdir --type=d dir | tail -n 1)" = "subdir" ] && \
+	[ "$(./pdir --type=f --min-size=1 dir | tail -n 1)" = "file2" ]
+status=$?
+rmdir dir/subdir
+if [ $status -gt 0 ]; then
+	exit 21;
+fi
+
+./pdir -l --xattr dir | grep -q '^-rw' && \
+	./pdir -lZ dir | grep -q ' root ? 5 '
+if [ $? -gt 0 ]; then
+	exit 22;
+fi
+
+touch dir/file10
+[ "$(./pdir -v dir | tail -n 1)" = "file10" ]
+status=$?
+rm dir/file10
+if [ $status -gt 0 ]; then
+	exit 23;
+fi
+
+[ "$(./pdir --max-iops=1000,10 -l dir)" = "$(./pdir -l dir)" ] && \
+	./pdir --stats -l dir 2>&1 >/dev/null | grep -q ' metadata calls, '
+if [ $? -gt 0 ]; then
+	exit 24;
+fi
+
+ln -s file2 dir/link
+ln -s missing dir/dangling
+./pdir -l dir | grep -q -- '-> file2$' && \
+	./pdir -l dir | grep -q -- '-> missing$'
+status=$?
+rm dir/link dir/dangling
+if [ $status -gt 0 ]; then
+	exit 25;
+fi
+
+touch dir/x.tar.gz
+[ "$(LS_COLORS='*.tar.gz=32:*.gz=31' ./pdir --color=always dir | \
+	grep x.tar.gz)" = "$(printf '\033[31mx.tar.gz\033[0m')" ]
+status=$?
+rm dir/x.tar.gz
+if [ $status -gt 0 ]; then
+	exit 26;
+fi
+
+./pdir --save-snapshot=snapshot dir && \
+	! ./pdir -v --diff-snapshot=snapshot dir 2>/dev/null
+if [ $? -gt 0 ]; then
+	exit 27;
+fi
+
+for opt in --checkpoint=checkpoint --save-snapshot=snapshot \
+		--diff-snapshot=snapshot --head=1 --tail=1; do
+	./pdir --merge $opt dir 2>/dev/null
+	if [ $? -ne 2 ]; then
+		exit 28;
+	fi
+done
+
+rm -f snapshot
+(umask 022; ./pdir --save-snapshot=snapshot dir >/dev/null) && \
+	[ "$(stat -c %a snapshot)" = 644 ]
+if [ $? -gt 0 ]; then
+	exit 29;
+fi
+
+mkdir dir/sub
+./pdir --estimate --type=f dir | grep -q '^directories: 0 +/- 0$'
+status=$?
+rmdir dir/sub
+if [ $status -gt 0 ]; then
+	exit 30;
 fi
 
 ## Clean up
-rm -rf dir
+rm -rf dir dir2 big snapshot checkpoint pdir.sock trace.json quote